@@ -0,0 +1,203 @@
+#ifndef ASSET_IO_H
+#define ASSET_IO_H
+
+//asset files are mapped instead of read into buffers of our own
+#include "MappedFile.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+//Memory that decoded assets are written into.
+//a single block that is reused for one asset after another. it only grows when an asset does not fit, so it ends up the size of the
+//largest asset it has held and after that decoding allocates nothing.
+class AssetArena
+{
+public:
+	//times the block had to grow, so a report can show it settled
+	unsigned int Grows;
+
+	AssetArena()
+		: Grows(0), data(nullptr), capacity(0), used(0)
+	{
+	};
+	~AssetArena()
+	{
+		delete[] this->data;
+	};
+	//throws away whatever the arena holds and makes sure the next size bytes fit
+	void Reset(size_t size)
+	{
+		this->used = 0;
+		if (size <= this->capacity)
+			return;
+		delete[] this->data;
+		this->data = new unsigned char[size];
+		this->capacity = size;
+		this->Grows++;
+	};
+	//nullptr if it does not fit into what the last Reset asked for
+	unsigned char* Allocate(size_t size)
+	{
+		//keep every allocation 16 byte aligned so rows can be read with SIMD loads
+		size_t offset = (this->used + 15) & ~(size_t)15;
+		if (offset + size > this->capacity)
+			return nullptr;
+		this->used = offset + size;
+		return this->data + offset;
+	};
+	size_t Capacity() const
+	{
+		return this->capacity;
+	};
+
+private:
+	unsigned char* data;
+	size_t capacity;
+	size_t used;
+
+	AssetArena(const AssetArena&);
+	AssetArena& operator=(const AssetArena&);
+};
+
+//Arenas for assets that are decoded on one thread and used on another. a decoder takes an arena, the asset keeps it until it has
+//been uploaded and then it is given back. there are never more arenas than assets in flight at the same time.
+//a taken arena is reset and grown by whoever holds it without any lock, so the pool never reads it then. the totals only take in
+//what an arena grew by once it is given back.
+class AssetArenaPool
+{
+public:
+	AssetArenaPool()
+		: capacity(0), grows(0)
+	{
+	};
+	~AssetArenaPool()
+	{
+		for (size_t i = 0; i < this->all.size(); i++)
+			delete this->all[i];
+	};
+	AssetArena* Take()
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		AssetArena* arena;
+		if (this->free.empty())
+		{
+			this->all.push_back(new AssetArena());
+			arena = this->all.back();
+		}
+		else
+		{
+			arena = this->free.back();
+			this->free.pop_back();
+		}
+		//nobody uses an arena in the free list, so it is safe to read here
+		TakenArena taken = { arena, arena->Capacity(), arena->Grows };
+		this->taken.push_back(taken);
+		return arena;
+	};
+	//call on the thread that holds the arena
+	void Give(AssetArena* arena)
+	{
+		size_t capacity = arena->Capacity();
+		unsigned int grows = arena->Grows;
+		std::lock_guard<std::mutex> lock(this->mutex);
+		for (size_t i = 0; i < this->taken.size(); i++)
+		{
+			if (this->taken[i].arena == arena)
+			{
+				this->capacity += capacity - this->taken[i].capacity;
+				this->grows += grows - this->taken[i].grows;
+				this->taken.erase(this->taken.begin() + i);
+				break;
+			}
+		}
+		this->free.push_back(arena);
+	};
+	//times any arena had to grow. it stops going up once every arena has held the largest asset
+	unsigned int Grows() const
+	{
+		return this->grows;
+	};
+	//bytes held by all arenas, as of when they were last given back
+	size_t Capacity() const
+	{
+		return this->capacity;
+	};
+
+private:
+	//an arena that is in use and what it held when it was taken
+	struct TakenArena
+	{
+		AssetArena* arena;
+		size_t capacity;
+		unsigned int grows;
+	};
+	std::mutex mutex;
+	std::vector<AssetArena*> all;
+	std::vector<AssetArena*> free;
+	std::vector<TakenArena> taken;
+	//only written in Give with the mutex held, read from any thread
+	std::atomic<size_t> capacity;
+	std::atomic<unsigned int> grows;
+};
+
+//Totals of every operator new and delete in the program, so startup can show how much it allocates.
+//the counting operators themselves are in Source.cpp: the global ones can only be replaced once in the whole program.
+//memory allocated inside C libraries (e.g. SOIL's malloc) does not go through them and is not counted. neither do the aligned
+//(std::align_val_t) forms, which are not replaced: nothing in the program allocates a type aligned beyond what plain new gives.
+class AllocationStats
+{
+public:
+	static std::atomic<unsigned long long> Allocations;
+	static std::atomic<unsigned long long> Frees;
+	static std::atomic<unsigned long long> Bytes;
+
+	static void Count(size_t size)
+	{
+		Allocations.fetch_add(1, std::memory_order_relaxed);
+		Bytes.fetch_add(size, std::memory_order_relaxed);
+	};
+	//the most physical memory the process has used so far, in KB. 0 if the OS can't tell us
+	static size_t PeakResidentKB()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0;
+		return counters.PeakWorkingSetSize / 1024;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+#ifdef __APPLE__
+		//bytes on macOS, KB everywhere else
+		return (size_t)usage.ru_maxrss / 1024;
+#else
+		return (size_t)usage.ru_maxrss;
+#endif
+#endif
+	};
+};
+
+std::atomic<unsigned long long> AllocationStats::Allocations(0);
+std::atomic<unsigned long long> AllocationStats::Frees(0);
+std::atomic<unsigned long long> AllocationStats::Bytes(0);
+
+#endif // ASSET_IO_H
@@ -0,0 +1,467 @@
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//Adding SOIL for loading textures in OpenGL. only the cooking step needs it
+#include<SOIL.h>
+//cooked files are memory mapped instead of read
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+//Texture that was converted offline ("cooked") into a GPU block-compressed format with all its mipmap levels already built.
+//JPEG/PNG textures have to be decoded on every launch, take 3-4 bytes per texel in VRAM and need glGenerateMipmap at runtime.
+//a cooked texture is uploaded as it is stored on disk: BC1 (DXT1) takes 0.5 bytes per texel and BC3 (DXT5), which also keeps alpha, takes 1.
+//BC1/BC3 compress each 4x4 block of texels into 2 endpoint colors plus a 2 bit index per texel that picks a color on the line between them.
+//
+//file layout, all values little endian GLuint:
+//	"OGTC", version, format (1 = BC1, 2 = BC3), width, height, level count
+//	then for every level: width, height, offset of its data from the start of the file, size of its data
+//	then the compressed data of every level
+class CookedTexture
+{
+public:
+	enum Format { BC1 = 1, BC3 = 2 };
+	struct Level
+	{
+		GLuint width, height;
+		const unsigned char* data;
+		GLuint size;
+	};
+
+	//maps a cooked file, or reads it with copy (see MappedFile). returns false if it is missing or not a valid cooked texture
+	bool Open(const std::string& path, bool copy = false)
+	{
+		this->levels.clear();
+		if (!this->file.Open(path, copy) || this->file.Size() < HeaderSize)
+			return false;
+		const unsigned char* data = this->file.Data();
+		if (memcmp(data, "OGTC", 4) != 0 || ReadUint(data + 4) != Version)
+			return false;
+		this->format = (Format)ReadUint(data + 8);
+		this->width = ReadUint(data + 12);
+		this->height = ReadUint(data + 16);
+		GLuint count = ReadUint(data + 20);
+		if ((this->format != BC1 && this->format != BC3) || this->file.Size() < HeaderSize + (size_t)count * LevelEntrySize)
+			return false;
+		for (GLuint i = 0; i < count; i++)
+		{
+			const unsigned char* entry = data + HeaderSize + i * LevelEntrySize;
+			Level level;
+			level.width = ReadUint(entry);
+			level.height = ReadUint(entry + 4);
+			GLuint offset = ReadUint(entry + 8);
+			level.size = ReadUint(entry + 12);
+			if ((size_t)offset + level.size > this->file.Size() || level.size != BlockCount(level.width, level.height) * BlockSize(this->format))
+				return false;
+			level.data = data + offset;
+			this->levels.push_back(level);
+		}
+		return !this->levels.empty();
+	};
+	Format GetFormat() const { return this->format; };
+	GLuint Width() const { return this->width; };
+	GLuint Height() const { return this->height; };
+	size_t LevelCount() const { return this->levels.size(); };
+	const Level& GetLevel(size_t index) const { return this->levels[index]; };
+	//the GL internal format to pass to glCompressedTexImage2D
+	GLenum GLFormat() const
+	{
+		return this->format == BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	};
+	//bytes of texture memory for all levels
+	size_t CompressedSize() const
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < this->levels.size(); i++)
+			total += this->levels[i].size;
+		return total;
+	};
+	//bytes needed to decode every level to RGBA8
+	size_t DecodedSize() const
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < this->levels.size(); i++)
+			total += (size_t)this->levels[i].width * this->levels[i].height * 4;
+		return total;
+	};
+	//for drivers without S3TC support. decodes a level into tightly packed RGBA8. rgba needs room for width * height * 4 bytes
+	void Decode(size_t index, unsigned char* rgba) const
+	{
+		const Level& level = this->levels[index];
+		GLuint blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+		const unsigned char* block = level.data;
+		for (GLuint by = 0; by < blocksY; by++)
+		{
+			for (GLuint bx = 0; bx < blocksX; bx++)
+			{
+				unsigned char texels[16 * 4];
+				if (this->format == BC3)
+				{
+					DecodeAlphaBlock(block, texels);
+					DecodeColorBlock(block + 8, texels, false);
+				}
+				else
+				{
+					DecodeColorBlock(block, texels, true);
+				}
+				block += BlockSize(this->format);
+				//copy the texels that fall inside the image. blocks on the right and bottom edge can stick out
+				for (GLuint y = 0; y < 4 && by * 4 + y < level.height; y++)
+					for (GLuint x = 0; x < 4 && bx * 4 + x < level.width; x++)
+						memcpy(&rgba[(((size_t)by * 4 + y) * level.width + bx * 4 + x) * 4], &texels[(y * 4 + x) * 4], 4);
+			}
+		}
+	};
+
+	//where the cooked version of an image lives: the same path with .tex added. the source extension stays,
+	//so wall.jpg and wall.png in one directory get wall.jpg.tex and wall.png.tex instead of overwriting each other
+	static std::string CookedPath(const std::string& source)
+	{
+		return source + ".tex";
+	};
+
+	//the offline step. loads an image with SOIL, builds the mipmap chain and writes every level compressed.
+	//images with any transparent texel are stored as BC3, everything else as BC1
+	static bool Cook(const std::string& source, const std::string& destination)
+	{
+		int w, h;
+		unsigned char* image = SOIL_load_image(source.c_str(), &w, &h, 0, SOIL_LOAD_RGBA);
+		if (image == nullptr)
+		{
+			std::cout << "ERROR::COOK::LOAD_FAILED " << source << std::endl;
+			return false;
+		}
+		std::vector<unsigned char> rgba(image, image + (size_t)w * h * 4);
+		SOIL_free_image_data(image);
+		Format format = BC1;
+		for (size_t i = 3; i < rgba.size(); i += 4)
+			if (rgba[i] != 255)
+				format = BC3;
+
+		//level 0 as it was before compressing, to measure what the compression lost
+		std::vector<unsigned char> original(rgba);
+
+		//compress every level, halving the size each time until we get to 1x1
+		std::vector<GLuint> levelInfo;
+		std::vector<unsigned char> compressed;
+		GLuint width = w, height = h;
+		for (;;)
+		{
+			levelInfo.push_back(width);
+			levelInfo.push_back(height);
+			levelInfo.push_back((GLuint)compressed.size());
+			CompressLevel(rgba, width, height, format, compressed);
+			levelInfo.push_back((GLuint)compressed.size() - levelInfo.back());
+			if (width == 1 && height == 1)
+				break;
+			Downsample(rgba, width, height);
+		}
+		GLuint count = (GLuint)levelInfo.size() / 4;
+		GLuint dataStart = HeaderSize + count * LevelEntrySize;
+		for (GLuint i = 0; i < count; i++)
+			levelInfo[i * 4 + 2] += dataStart;
+
+		std::ofstream out(destination.c_str(), std::ios::binary | std::ios::trunc);
+		GLuint header[] = { Version, (GLuint)format, (GLuint)w, (GLuint)h, count };
+		out.write("OGTC", 4);
+		for (int i = 0; i < 5; i++)
+			WriteUint(out, header[i]);
+		for (size_t i = 0; i < levelInfo.size(); i++)
+			WriteUint(out, levelInfo[i]);
+		out.write((const char*)&compressed[0], compressed.size());
+		out.close();
+		if (!out)
+		{
+			std::cout << "ERROR::COOK::WRITE_FAILED " << destination << std::endl;
+			return false;
+		}
+		//read the file back the way the loader does and compare its top level against the source image. BC1 drops alpha, so only
+		//BC3 has it counted
+		CookedTexture cooked;
+		if (!cooked.Open(destination))
+		{
+			std::cout << "ERROR::COOK::READ_BACK_FAILED " << destination << std::endl;
+			return false;
+		}
+		std::vector<unsigned char> decoded((size_t)w * h * 4);
+		cooked.Decode(0, &decoded[0]);
+		std::cout << "Cooked " << source << " -> " << destination << " (" << w << "x" << h << ", " << (format == BC1 ? "BC1" : "BC3") << ", "
+			<< count << " levels, " << (compressed.size() / 1024) << " KB, PSNR " << Psnr(original, decoded, format == BC1 ? 3 : 4) << " dB)" << std::endl;
+		return true;
+	};
+
+private:
+	static const GLuint Version = 1;
+	static const size_t HeaderSize = 24;
+	static const size_t LevelEntrySize = 16;
+	MappedFile file;
+	Format format;
+	GLuint width, height;
+	std::vector<Level> levels;
+
+	//peak signal to noise ratio of b against a over the first channels of every RGBA texel. higher is closer, 40 dB and up is hard to tell apart
+	static double Psnr(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, int channels)
+	{
+		double squaredError = 0.0;
+		size_t samples = 0;
+		for (size_t i = 0; i < a.size(); i += 4)
+			for (int c = 0; c < channels; c++, samples++)
+				squaredError += ((double)a[i + c] - b[i + c]) * ((double)a[i + c] - b[i + c]);
+		if (squaredError == 0.0)
+			return INFINITY;
+		return 10.0 * log10(255.0 * 255.0 * samples / squaredError);
+	};
+	static GLuint BlockCount(GLuint width, GLuint height)
+	{
+		return ((width + 3) / 4) * ((height + 3) / 4);
+	};
+	static GLuint BlockSize(Format format)
+	{
+		return format == BC1 ? 8 : 16;
+	};
+	static GLuint ReadUint(const unsigned char* p)
+	{
+		return p[0] | (p[1] << 8) | (p[2] << 16) | ((GLuint)p[3] << 24);
+	};
+	static void WriteUint(std::ofstream& out, GLuint value)
+	{
+		unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+		out.write((const char*)bytes, 4);
+	};
+
+	//2x2 box filter. odd sizes reuse the last row/column
+	static void Downsample(std::vector<unsigned char>& rgba, GLuint& width, GLuint& height)
+	{
+		GLuint newWidth = width > 1 ? width / 2 : 1, newHeight = height > 1 ? height / 2 : 1;
+		std::vector<unsigned char> result((size_t)newWidth * newHeight * 4);
+		for (GLuint y = 0; y < newHeight; y++)
+		{
+			GLuint y0 = y * 2, y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+			for (GLuint x = 0; x < newWidth; x++)
+			{
+				GLuint x0 = x * 2, x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+				for (int c = 0; c < 4; c++)
+				{
+					GLuint sum = rgba[((size_t)y0 * width + x0) * 4 + c] + rgba[((size_t)y0 * width + x1) * 4 + c]
+						+ rgba[((size_t)y1 * width + x0) * 4 + c] + rgba[((size_t)y1 * width + x1) * 4 + c];
+					result[((size_t)y * newWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		rgba.swap(result);
+		width = newWidth;
+		height = newHeight;
+	};
+	static void CompressLevel(const std::vector<unsigned char>& rgba, GLuint width, GLuint height, Format format, std::vector<unsigned char>& out)
+	{
+		for (GLuint by = 0; by < height; by += 4)
+		{
+			for (GLuint bx = 0; bx < width; bx += 4)
+			{
+				//gather the 4x4 block. texels outside the image repeat the edge
+				unsigned char texels[16 * 4];
+				for (GLuint y = 0; y < 4; y++)
+				{
+					GLuint sy = by + y < height ? by + y : height - 1;
+					for (GLuint x = 0; x < 4; x++)
+					{
+						GLuint sx = bx + x < width ? bx + x : width - 1;
+						memcpy(&texels[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+					}
+				}
+				unsigned char block[16];
+				if (format == BC3)
+				{
+					EncodeAlphaBlock(texels, block);
+					EncodeColorBlock(texels, block + 8);
+				}
+				else
+				{
+					EncodeColorBlock(texels, block);
+				}
+				out.insert(out.end(), block, block + BlockSize(format));
+			}
+		}
+	};
+
+	static unsigned short To565(const int color[3])
+	{
+		return (unsigned short)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+	};
+	static void From565(unsigned short value, int color[3])
+	{
+		int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	};
+	//the 4 colors a BC color block can pick from. with threeColor set (BC1 with c0 <= c1) the 4th entry is transparent black
+	static void Palette(unsigned short c0, unsigned short c1, bool threeColor, int palette[4][4])
+	{
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+		for (int c = 0; c < 3; c++)
+		{
+			if (threeColor)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			else
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = threeColor ? 0 : 255;
+	};
+	//picks the endpoints from the bounding box of the block's colors, pulled in a little so the extremes don't waste precision,
+	//then gives every texel the index of the closest palette color
+	static void EncodeColorBlock(const unsigned char texels[16 * 4], unsigned char out[8])
+	{
+		int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				int value = texels[i * 4 + c];
+				low[c] = value < low[c] ? value : low[c];
+				high[c] = value > high[c] ? value : high[c];
+			}
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			int inset = (high[c] - low[c]) / 16;
+			low[c] += inset;
+			high[c] -= inset;
+		}
+		unsigned short c0 = To565(high), c1 = To565(low);
+		//c0 > c1 selects the 4 color mode in BC1. BC3 always uses 4 colors
+		if (c0 < c1)
+		{
+			unsigned short swap = c0;
+			c0 = c1;
+			c1 = swap;
+		}
+		int palette[4][4];
+		Palette(c0, c1, false, palette);
+		unsigned int indices = 0;
+		if (c0 != c1)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestDistance = 0x7fffffff;
+				for (int p = 0; p < 4; p++)
+				{
+					int distance = 0;
+					for (int c = 0; c < 3; c++)
+						distance += (texels[i * 4 + c] - palette[p][c]) * (texels[i * 4 + c] - palette[p][c]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= best << (i * 2);
+			}
+		}
+		out[0] = (unsigned char)c0;
+		out[1] = (unsigned char)(c0 >> 8);
+		out[2] = (unsigned char)c1;
+		out[3] = (unsigned char)(c1 >> 8);
+		for (int i = 0; i < 4; i++)
+			out[4 + i] = (unsigned char)(indices >> (i * 8));
+	};
+	static void DecodeColorBlock(const unsigned char block[8], unsigned char texels[16 * 4], bool allowThreeColor)
+	{
+		unsigned short c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+		int palette[4][4];
+		Palette(c0, c1, allowThreeColor && c0 <= c1, palette);
+		unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (indices >> (i * 2)) & 3;
+			//BC3 keeps the alpha the alpha block already wrote
+			int components = allowThreeColor ? 4 : 3;
+			for (int c = 0; c < components; c++)
+				texels[i * 4 + c] = (unsigned char)palette[index][c];
+		}
+	};
+	//the 8 alpha values a BC3 alpha block can pick from when a0 > a1
+	static void AlphaPalette(int a0, int a1, int palette[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+	};
+	static void EncodeAlphaBlock(const unsigned char texels[16 * 4], unsigned char out[8])
+	{
+		int a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			int alpha = texels[i * 4 + 3];
+			a0 = alpha > a0 ? alpha : a0;
+			a1 = alpha < a1 ? alpha : a1;
+		}
+		out[0] = (unsigned char)a0;
+		out[1] = (unsigned char)a1;
+		unsigned long long indices = 0;
+		if (a0 != a1)
+		{
+			int palette[8];
+			AlphaPalette(a0, a1, palette);
+			for (int i = 0; i < 16; i++)
+			{
+				int alpha = texels[i * 4 + 3], best = 0, bestDistance = 256;
+				for (int p = 0; p < 8; p++)
+				{
+					int distance = alpha > palette[p] ? alpha - palette[p] : palette[p] - alpha;
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= (unsigned long long)best << (i * 3);
+			}
+		}
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (unsigned char)(indices >> (i * 8));
+	};
+	static void DecodeAlphaBlock(const unsigned char block[8], unsigned char texels[16 * 4])
+	{
+		int a0 = block[0], a1 = block[1];
+		int palette[8];
+		if (a0 > a1)
+		{
+			AlphaPalette(a0, a1, palette);
+		}
+		else
+		{
+			//6 interpolated values plus fully transparent and fully opaque
+			palette[0] = a0;
+			palette[1] = a1;
+			for (int i = 1; i < 5; i++)
+				palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		unsigned long long indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= (unsigned long long)block[2 + i] << (i * 8);
+		for (int i = 0; i < 16; i++)
+			texels[i * 4 + 3] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+	};
+};
+
+#endif // COOKED_TEXTURE_H
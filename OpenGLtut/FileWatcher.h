@@ -0,0 +1,180 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+//Tells us when files we care about have been written.
+//on Linux this uses inotify on the directories the files are in. watching the directory instead of the file itself also catches
+//editors that save by writing a new file and renaming it over the old one. elsewhere the write times are polled.
+//Wait is meant to be called in a loop from a background thread.
+class FileWatcher
+{
+public:
+	FileWatcher()
+	{
+#ifdef __linux__
+		this->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+	};
+	~FileWatcher()
+	{
+#ifdef __linux__
+		if (this->inotify >= 0)
+			close(this->inotify);
+#endif
+	};
+
+	//must be called before the thread calling Wait starts
+	void Watch(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+		std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+		this->files[std::make_pair(directory, name)] = path;
+		this->writeTimes[path] = LastWriteTime(path);
+#ifdef __linux__
+		for (std::map<int, std::string>::iterator it = this->directories.begin(); it != this->directories.end(); ++it)
+			if (it->second == directory)
+				return;
+		int watch = inotify_add_watch(this->inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (watch >= 0)
+			this->directories[watch] = directory;
+#endif
+	};
+
+	//waits up to timeoutMs for a watched file to change and returns the paths that changed (as they were passed to Watch).
+	//saving a file often shows up as several writes, so once something changed we keep collecting until the files have been quiet for a moment.
+	//every write starts the quiet period again, also one to a file that is already in the list.
+	//firstSeen is set to when the first of the changes was noticed
+	std::vector<std::string> Wait(int timeoutMs, std::chrono::steady_clock::time_point* firstSeen = nullptr)
+	{
+		std::vector<std::string> changed;
+		int wait = timeoutMs;
+		for (;;)
+		{
+			size_t before = changed.size();
+			if (!this->Collect(wait, changed))
+				return changed;
+			if (before == 0 && !changed.empty() && firstSeen != nullptr)
+				*firstSeen = std::chrono::steady_clock::now();
+			wait = QuietMs;
+		}
+	};
+
+	//last modification time of a file in nanoseconds (in the file system's own epoch). 0 if the file does not exist
+	static long long LastWriteTime(const std::string& path)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+			return 0;
+		ULARGE_INTEGER time;
+		time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+		time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+		//FILETIME counts 100 nanosecond intervals
+		return (long long)time.QuadPart * 100;
+#else
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+			return 0;
+#ifdef __linux__
+		return (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#else
+		return (long long)info.st_mtime * 1000000000LL;
+#endif
+#endif
+	};
+
+private:
+	//how long the files have to be left alone before we report a change
+	static const int QuietMs = 30;
+	//(directory, file name) -> path as given to Watch
+	std::map<std::pair<std::string, std::string>, std::string> files;
+	std::map<std::string, long long> writeTimes;
+#ifdef __linux__
+	int inotify;
+	//watch descriptor -> directory
+	std::map<int, std::string> directories;
+#endif
+
+	void Add(const std::string& path, std::vector<std::string>& changed)
+	{
+		for (size_t i = 0; i < changed.size(); i++)
+			if (changed[i] == path)
+				return;
+		changed.push_back(path);
+	};
+	//true if a watched file was written within timeoutMs, whether or not it was already in changed
+	bool Collect(int timeoutMs, std::vector<std::string>& changed)
+	{
+		bool written = false;
+#ifdef __linux__
+		if (this->inotify >= 0)
+		{
+			//other files in the same directories wake us up too. those don't count, so we keep waiting until the timeout is over
+			std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+			while (!written)
+			{
+				int remaining = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+				pollfd request = { this->inotify, POLLIN, 0 };
+				if (remaining <= 0 || poll(&request, 1, remaining) <= 0)
+					return false;
+				//events are variable length (the file name follows the header), so read them into a buffer aligned for the header
+				alignas(inotify_event) char buffer[4096];
+				ssize_t length;
+				while ((length = read(this->inotify, buffer, sizeof(buffer))) > 0)
+				{
+					for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event*)p)->len)
+					{
+						inotify_event* event = (inotify_event*)p;
+						if (event->len == 0 || this->directories.count(event->wd) == 0)
+							continue;
+						std::map<std::pair<std::string, std::string>, std::string>::iterator file = this->files.find(std::make_pair(this->directories[event->wd], std::string(event->name)));
+						if (file != this->files.end())
+						{
+							this->Add(file->second, changed);
+							written = true;
+						}
+					}
+				}
+			}
+			return true;
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+		for (std::map<std::string, long long>::iterator it = this->writeTimes.begin(); it != this->writeTimes.end(); ++it)
+		{
+			long long time = LastWriteTime(it->first);
+			if (time != it->second)
+			{
+				it->second = time;
+				this->Add(it->first, changed);
+				written = true;
+			}
+		}
+		return written;
+	};
+};
+
+#endif // FILE_WATCHER_H
@@ -0,0 +1,254 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//the waits handle window events as they arrive, so input is timestamped when it comes in rather than when the frame polls
+#include<GLFW\glfw3.h>
+
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+//Decides when each frame starts and how far the simulation moves in it.
+//- the simulation always advances in fixed steps (1/60 s by default) no matter how fast we render. rendering gets an interpolation
+//  factor between the last two simulation states so motion stays smooth at any frame rate.
+//- with a target frame rate, the pacer waits for the next frame's start time. it sleeps for most of the wait (no CPU used) and spins
+//  for the last bit because sleep is not precise. the spin margin adapts to how much the OS oversleeps.
+//- with maxFramesInFlight set, a fence is placed after every frame and we wait for the fence of the frame maxFramesInFlight back before
+//  starting a new one. that stops the CPU from queueing frames ahead of the GPU, which is where most input latency comes from.
+//- with vsync on, swapping the buffers already waits for the display, so the pacer does not wait as well.
+//- input events are timestamped so we can report how long it took until the frame that saw them was submitted. the pacer handles
+//  events while it waits (glfwWaitEventsTimeout instead of a plain sleep), so an event that arrives during the wait is timestamped
+//  then and not when the frame polls. with vsync the wait happens inside the buffer swap instead, and events that arrive during
+//  the swap are only timestamped when the next frame polls.
+class FramePacer
+{
+public:
+	//targetFps 0 means uncapped. maxFramesInFlight 0 disables the GPU throttling
+	FramePacer(double targetFps = 0.0, double simulationHz = 60.0, int maxFramesInFlight = 0)
+		: simulationStep(1.0 / simulationHz), maxFramesInFlight(maxFramesInFlight), vsync(false), accumulator(0.0), spinMargin(0.002), steps(0),
+		frameIndex(0), pendingInput(false), inputLatencySum(0.0), inputCount(0)
+	{
+		this->SetTargetFps(targetFps);
+		this->nextFrameTime = this->Now();
+		this->lastFrameStart = this->nextFrameTime;
+		this->ResetStats();
+	};
+	~FramePacer()
+	{
+		while (!this->fences.empty())
+		{
+			glDeleteSync(this->fences.front());
+			this->fences.pop_front();
+		}
+	};
+	void SetTargetFps(double fps)
+	{
+		this->targetFps = fps;
+		this->frameInterval = fps > 0.0 ? 1.0 / fps : 0.0;
+		this->nextFrameTime = this->Now();
+	};
+	double TargetFps() const { return this->targetFps; };
+	//call with true when the swap interval is 1 and the target rate is the display's refresh rate
+	void SetVsync(bool vsync) { this->vsync = vsync; };
+
+	//waits until it is time to start the next frame. call before polling input so the frame sees the freshest events
+	void WaitForNextFrame()
+	{
+		this->ThrottleGpu();
+		if (this->frameInterval > 0.0 && !this->vsync)
+		{
+			double remaining = this->nextFrameTime - this->Now();
+			if (remaining > this->spinMargin)
+			{
+				//sleep for everything except the spin margin, then check how far off the sleep was.
+				//the wait returns early for every event, so keep waiting until the sleep is really over
+				double wakeTime = this->nextFrameTime - this->spinMargin;
+				for (double left = wakeTime - this->Now(); left > 0.0; left = wakeTime - this->Now())
+					glfwWaitEventsTimeout(left);
+				double overslept = this->Now() - wakeTime;
+				//keep the margin a bit above the typical oversleep, but let it shrink slowly when the OS behaves
+				double wanted = overslept * 1.5 + 0.0002;
+				this->spinMargin = wanted > this->spinMargin ? wanted : this->spinMargin * 0.95 + wanted * 0.05;
+			}
+			while (this->Now() < this->nextFrameTime)
+			{
+				glfwPollEvents();
+				std::this_thread::yield();
+			}
+			this->nextFrameTime += this->frameInterval;
+			//if we fell more than a frame behind don't try to catch up with a burst of frames
+			if (this->nextFrameTime < this->Now())
+				this->nextFrameTime = this->Now() + this->frameInterval;
+		}
+		double start = this->Now();
+		double elapsed = start - this->lastFrameStart;
+		this->lastFrameStart = start;
+		//only sums are kept, so a run of any length takes no more memory. the first interval includes whatever happened before
+		//the stats were reset and is left out
+		if (this->skipInterval)
+		{
+			this->skipInterval = false;
+		}
+		else
+		{
+			this->intervalCount++;
+			this->intervalSum += elapsed;
+			this->intervalSquareSum += elapsed * elapsed;
+		}
+		//the time since the last frame feeds the fixed step simulation. clamp it so a long stall doesn't make us simulate for ages
+		this->accumulator += elapsed < 0.25 ? elapsed : 0.25;
+		this->steps = 0;
+		while (this->accumulator >= this->simulationStep)
+		{
+			this->accumulator -= this->simulationStep;
+			this->steps++;
+		}
+	};
+	//number of fixed simulation steps to run this frame
+	int SimulationSteps() const { return this->steps; };
+	double SimulationStep() const { return this->simulationStep; };
+	//how far we are between the previous and the current simulation state. 0 is previous, 1 is current
+	double Alpha() const { return this->accumulator / this->simulationStep; };
+
+	//call from the input callback
+	void OnInput()
+	{
+		if (!this->pendingInput)
+		{
+			this->pendingInput = true;
+			this->inputTime = this->Now();
+		}
+	};
+	//call right after the frame has been submitted (after swapping buffers)
+	void EndFrame()
+	{
+		this->frameIndex++;
+		if (this->maxFramesInFlight > 0)
+			this->fences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+		if (this->pendingInput)
+		{
+			double latencyMs = (this->Now() - this->inputTime) * 1000.0;
+			std::cout << "Frame " << this->frameIndex << ": input latency " << latencyMs << " ms" << std::endl;
+			this->inputLatencySum += latencyMs;
+			this->inputCount++;
+			this->pendingInput = false;
+		}
+	};
+
+	//clears the frame interval and CPU usage measurements, e.g. when switching target rate in the benchmark
+	void ResetStats()
+	{
+		this->intervalCount = 0;
+		this->intervalSum = 0.0;
+		this->intervalSquareSum = 0.0;
+		this->skipInterval = true;
+		this->statsStartWall = this->Now();
+		this->statsStartCpu = ProcessCpuSeconds();
+		this->lastFrameStart = this->statsStartWall;
+	};
+	void Report()
+	{
+		double wall = this->Now() - this->statsStartWall;
+		double cpu = ProcessCpuSeconds() - this->statsStartCpu;
+		double mean = 0.0, variance = 0.0;
+		if (this->intervalCount > 0)
+		{
+			mean = this->intervalSum / this->intervalCount;
+			//E[x^2] - E[x]^2 can come out a hair below 0 from rounding when every interval is the same
+			variance = this->intervalSquareSum / this->intervalCount - mean * mean;
+			if (variance < 0.0)
+				variance = 0.0;
+		}
+		std::cout << "Pacing (target " << (this->targetFps > 0.0 ? this->targetFps : 0.0) << " fps" << (this->targetFps > 0.0 ? "" : " = uncapped")
+			<< (this->vsync ? ", vsync" : "")
+			<< ", frames in flight " << this->maxFramesInFlight << "): " << (mean > 0.0 ? 1.0 / mean : 0.0) << " fps, frame interval "
+			<< (mean * 1000.0) << " ms, jitter (std dev) " << (sqrt(variance) * 1000.0) << " ms, CPU utilisation "
+			<< (wall > 0.0 ? cpu / wall * 100.0 : 0.0) << "%" << std::endl;
+		if (this->inputCount > 0)
+			std::cout << "Average input latency: " << (this->inputLatencySum / this->inputCount) << " ms over " << this->inputCount << " inputs" << std::endl;
+	};
+
+	//CPU time used by the whole process so far, in seconds
+	static double ProcessCpuSeconds()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+			return 0.0;
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernel.dwLowDateTime;
+		k.HighPart = kernel.dwHighDateTime;
+		u.LowPart = user.dwLowDateTime;
+		u.HighPart = user.dwHighDateTime;
+		//FILETIME counts 100 nanosecond intervals
+		return (k.QuadPart + u.QuadPart) / 10000000.0;
+#else
+		timespec ts;
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+		return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+	};
+
+private:
+	double targetFps;
+	double frameInterval;
+	double simulationStep;
+	int maxFramesInFlight;
+	bool vsync;
+	double accumulator;
+	//how long before the frame start we stop sleeping and start spinning
+	double spinMargin;
+	int steps;
+	double nextFrameTime;
+	double lastFrameStart;
+	GLuint frameIndex;
+	std::deque<GLsync> fences;
+	bool pendingInput;
+	double inputTime;
+	double inputLatencySum;
+	GLuint inputCount;
+	unsigned long long intervalCount;
+	double intervalSum;
+	double intervalSquareSum;
+	bool skipInterval;
+	double statsStartWall;
+	double statsStartCpu;
+
+	double Now() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	};
+	//waits for the GPU to finish the frame maxFramesInFlight frames back
+	void ThrottleGpu()
+	{
+		while (this->maxFramesInFlight > 0 && (int)this->fences.size() >= this->maxFramesInFlight)
+		{
+			GLenum result = glClientWaitSync(this->fences.front(), GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while (result == GL_TIMEOUT_EXPIRED)
+			{
+				glfwPollEvents();
+				result = glClientWaitSync(this->fences.front(), 0, 1000000);
+			}
+			glDeleteSync(this->fences.front());
+			this->fences.pop_front();
+		}
+	};
+};
+
+#endif // FRAME_PACER_H
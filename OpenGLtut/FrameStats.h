@@ -0,0 +1,138 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+//Collects CPU and GPU time for every frame and prints min/mean/p99 at the end of a run.
+//CPU time is measured with a high resolution clock from BeginFrame to EndFrame.
+//GPU time comes from GL_TIME_ELAPSED queries. a query result is only available once the GPU has finished the frame,
+//so we keep a small ring of queries and read each one a few frames later instead of waiting for it right away.
+//the first few frames are dominated by one-off work (texture uploads, driver warm-up) so they are left out of the summary.
+//min and mean come from running sums over the whole run. p99 needs the samples themselves, so only the most recent
+//WindowSize frames are kept. a windowed session can run for hours and must not grow the stats with every frame.
+class FrameStats
+{
+public:
+	FrameStats(int warmupFrames = 1)
+		: warmupFrames(warmupFrames), frame(0), next(0)
+	{
+		glGenQueries(QueryCount, this->queries);
+		for (int i = 0; i < QueryCount; i++)
+			this->pending[i] = false;
+	};
+	~FrameStats()
+	{
+		glDeleteQueries(QueryCount, this->queries);
+	};
+
+	void BeginFrame()
+	{
+		//the query we are about to reuse was issued QueryCount frames ago. its result is almost always there by now
+		this->Collect(this->next, true);
+		glBeginQuery(GL_TIME_ELAPSED, this->queries[this->next]);
+		this->queryFrame[this->next] = this->frame;
+		this->frameStart = std::chrono::high_resolution_clock::now();
+	};
+	void EndFrame()
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		this->pending[this->next] = true;
+		this->next = (this->next + 1) % QueryCount;
+		if (this->frame >= this->warmupFrames)
+			this->cpuMs.Add(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - this->frameStart).count());
+		this->frame++;
+		//pick up any other results that are ready without waiting for them
+		for (int i = 0; i < QueryCount; i++)
+			this->Collect(i, false);
+	};
+	size_t Frames() const
+	{
+		return this->cpuMs.count;
+	};
+	//waits for the outstanding GPU queries and prints the summary
+	void Report()
+	{
+		for (int i = 0; i < QueryCount; i++)
+			this->Collect(i, true);
+		std::cout << "Frames: " << this->cpuMs.count << " (after " << this->warmupFrames << " warm-up)" << std::endl;
+		Print("CPU frame time", this->cpuMs);
+		Print("GPU frame time", this->gpuMs);
+	};
+
+private:
+	static const int QueryCount = 4;
+	//number of recent samples kept for the p99. covers a whole benchmark run, or about a minute of a windowed session
+	static const size_t WindowSize = 4096;
+	//running sums over every sample plus a ring of the most recent ones
+	struct Series
+	{
+		size_t count;
+		double sum;
+		double min;
+		size_t next;
+		std::vector<double> window;
+		Series() : count(0), sum(0.0), min(0.0), next(0) { this->window.reserve(WindowSize); };
+		void Add(double ms)
+		{
+			this->min = this->count == 0 || ms < this->min ? ms : this->min;
+			this->sum += ms;
+			this->count++;
+			if (this->window.size() < WindowSize)
+				this->window.push_back(ms);
+			else
+				this->window[this->next] = ms;
+			this->next = (this->next + 1) % WindowSize;
+		};
+	};
+	GLuint queries[QueryCount];
+	bool pending[QueryCount];
+	//frame each query was issued in
+	int queryFrame[QueryCount];
+	int warmupFrames;
+	int frame;
+	int next;
+	std::chrono::high_resolution_clock::time_point frameStart;
+	Series cpuMs;
+	Series gpuMs;
+
+	//reads a finished query into gpuMs. only blocks if wait is true
+	void Collect(int index, bool wait)
+	{
+		if (!this->pending[index])
+			return;
+		if (!wait)
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(this->queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				return;
+		}
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(this->queries[index], GL_QUERY_RESULT, &elapsed);
+		if (this->queryFrame[index] >= this->warmupFrames)
+			this->gpuMs.Add(elapsed / 1000000.0);
+		this->pending[index] = false;
+	};
+	static void Print(const char* label, const Series& series)
+	{
+		if (series.count == 0)
+			return;
+		std::vector<double> samples(series.window);
+		std::sort(samples.begin(), samples.end());
+		size_t p99 = (samples.size() * 99) / 100;
+		if (p99 >= samples.size())
+			p99 = samples.size() - 1;
+		std::cout << label << ": min " << series.min << " ms, mean " << (series.sum / series.count) << " ms, p99 " << samples[p99] << " ms";
+		if (series.count > samples.size())
+			std::cout << " (last " << samples.size() << " frames)";
+		std::cout << std::endl;
+	};
+};
+
+#endif // FRAME_STATS_H
@@ -0,0 +1,204 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+
+//Remembers the GL state we set last and drops calls that would set the same value again.
+//OpenGL is a state machine and every bind or state call costs a trip into the driver even when nothing changes,
+//e.g. binding the same program, VAO and textures at the start of every frame. all code that binds things on the main context
+//goes through GLState::Current() so the cached values always match what GL really has bound.
+//the element array buffer binding is part of the VAO, so it is not cached here and is always passed straight to GL.
+//objects created on another context (e.g. a loader thread) have their own state and must not use this class.
+class GLState
+{
+public:
+	//calls passed on to GL and calls dropped because the value was already current, so the render loop can report the savings
+	GLuint CallsIssued;
+	GLuint CallsElided;
+
+	//the state cache of the main GL context
+	static GLState& Current()
+	{
+		static GLState state;
+		return state;
+	};
+
+	void UseProgram(GLuint program)
+	{
+		if (this->Elide(this->program == program))
+			return;
+		this->program = program;
+		glUseProgram(program);
+	};
+	void BindVertexArray(GLuint vao)
+	{
+		if (this->Elide(this->vao == vao))
+			return;
+		this->vao = vao;
+		glBindVertexArray(vao);
+	};
+	void BindBuffer(GLenum target, GLuint buffer)
+	{
+		GLuint* cached = this->BufferSlot(target);
+		if (cached == nullptr)
+		{
+			this->CallsIssued++;
+			glBindBuffer(target, buffer);
+			return;
+		}
+		if (this->Elide(*cached == buffer))
+			return;
+		*cached = buffer;
+		glBindBuffer(target, buffer);
+	};
+	//binds part of a buffer to an indexed binding point, e.g. a uniform block binding. GL also binds the buffer to the
+	//plain target as a side effect, so the cached binding is updated to match. the indexed bindings themselves are not cached
+	void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+	{
+		GLuint* cached = this->BufferSlot(target);
+		if (cached != nullptr)
+			*cached = buffer;
+		this->CallsIssued++;
+		glBindBufferRange(target, index, buffer, offset, size);
+	};
+	void ActiveTexture(GLuint unit)
+	{
+		if (this->Elide(this->activeUnit == unit))
+			return;
+		this->activeUnit = unit;
+		glActiveTexture(GL_TEXTURE0 + unit);
+	};
+	//binds a 2D texture to the given texture unit. only switches the active unit if the binding actually changes
+	void BindTexture(GLuint unit, GLuint texture)
+	{
+		if (unit >= MaxUnits)
+		{
+			this->ActiveTexture(unit);
+			this->CallsIssued++;
+			glBindTexture(GL_TEXTURE_2D, texture);
+			return;
+		}
+		if (this->Elide(this->textures[unit] == texture))
+			return;
+		this->ActiveTexture(unit);
+		this->textures[unit] = texture;
+		glBindTexture(GL_TEXTURE_2D, texture);
+	};
+	//binds a 2D texture to whatever unit is active. used when we only want to edit a texture, not draw with it
+	void BindTexture(GLuint texture)
+	{
+		this->BindTexture(this->activeUnit, texture);
+	};
+	//target is GL_FRAMEBUFFER (both), GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER
+	void BindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		bool draw = target != GL_READ_FRAMEBUFFER;
+		bool read = target != GL_DRAW_FRAMEBUFFER;
+		if (this->Elide((!draw || this->drawFramebuffer == framebuffer) && (!read || this->readFramebuffer == framebuffer)))
+			return;
+		if (draw)
+			this->drawFramebuffer = framebuffer;
+		if (read)
+			this->readFramebuffer = framebuffer;
+		glBindFramebuffer(target, framebuffer);
+	};
+	void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+	{
+		if (this->Elide(this->clearColor[0] == r && this->clearColor[1] == g && this->clearColor[2] == b && this->clearColor[3] == a))
+			return;
+		this->clearColor[0] = r;
+		this->clearColor[1] = g;
+		this->clearColor[2] = b;
+		this->clearColor[3] = a;
+		glClearColor(r, g, b, a);
+	};
+
+	//deleting a bound texture, buffer or VAO resets that binding to 0 in GL, so the cache has to forget it too.
+	//a program in use is different: it stays current and is only marked for deletion until another one is used. the cache forgets it
+	//anyway, so the next UseProgram with a name GL may hand out again is sent instead of dropped
+	void DeleteProgram(GLuint program)
+	{
+		if (this->program == program)
+			this->program = 0;
+		glDeleteProgram(program);
+	};
+	void DeleteVertexArray(GLuint vao)
+	{
+		if (this->vao == vao)
+			this->vao = 0;
+		glDeleteVertexArrays(1, &vao);
+	};
+	void DeleteBuffer(GLuint buffer)
+	{
+		for (int i = 0; i < BufferTargets; i++)
+			if (this->buffers[i] == buffer)
+				this->buffers[i] = 0;
+		glDeleteBuffers(1, &buffer);
+	};
+	void DeleteTexture(GLuint texture)
+	{
+		for (GLuint i = 0; i < MaxUnits; i++)
+			if (this->textures[i] == texture)
+				this->textures[i] = 0;
+		glDeleteTextures(1, &texture);
+	};
+	void DeleteFramebuffer(GLuint framebuffer)
+	{
+		if (this->drawFramebuffer == framebuffer)
+			this->drawFramebuffer = 0;
+		if (this->readFramebuffer == framebuffer)
+			this->readFramebuffer = 0;
+		glDeleteFramebuffers(1, &framebuffer);
+	};
+
+private:
+	static const GLuint MaxUnits = 32;
+	static const int BufferTargets = 4;
+	GLuint program;
+	GLuint vao;
+	//GL_ARRAY_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_PIXEL_PACK_BUFFER, GL_UNIFORM_BUFFER
+	GLuint buffers[BufferTargets];
+	GLuint activeUnit;
+	GLuint textures[MaxUnits];
+	GLuint drawFramebuffer;
+	GLuint readFramebuffer;
+	GLfloat clearColor[4];
+
+	//starts out matching the default GL state of a new context
+	GLState()
+		: CallsIssued(0), CallsElided(0), program(0), vao(0), activeUnit(0), drawFramebuffer(0), readFramebuffer(0)
+	{
+		for (int i = 0; i < BufferTargets; i++)
+			this->buffers[i] = 0;
+		for (GLuint i = 0; i < MaxUnits; i++)
+			this->textures[i] = 0;
+		for (int i = 0; i < 4; i++)
+			this->clearColor[i] = 0.0f;
+	};
+	GLState(const GLState&);
+	GLState& operator=(const GLState&);
+
+	//counts the call and returns true if it can be dropped
+	bool Elide(bool alreadySet)
+	{
+		if (alreadySet)
+			this->CallsElided++;
+		else
+			this->CallsIssued++;
+		return alreadySet;
+	};
+	GLuint* BufferSlot(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER: return &this->buffers[0];
+		case GL_PIXEL_UNPACK_BUFFER: return &this->buffers[1];
+		case GL_PIXEL_PACK_BUFFER: return &this->buffers[2];
+		case GL_UNIFORM_BUFFER: return &this->buffers[3];
+		default: return nullptr;
+		}
+	};
+};
+
+#endif // GL_STATE_H
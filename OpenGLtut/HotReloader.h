@@ -0,0 +1,276 @@
+#ifndef HOT_RELOADER_H
+#define HOT_RELOADER_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//GLFW creates the hidden context the shaders are rebuilt on
+#include<GLFW\glfw3.h>
+//bindings go through the state cache so it stays in sync with GL
+#include "GLState.h"
+#include "Shader.h"
+#include "TextureLoader.h"
+#include "FileWatcher.h"
+#include "Profiler.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+//Rebuilds shaders and textures when their files change, while the program keeps running.
+//a background thread waits for file changes. shaders are compiled and linked right there on a hidden context that shares objects
+//with the main one, so the render loop never waits for the compiler. textures are handed to the texture loader, which decodes them
+//on its own workers. either way the new object replaces the old one at the start of a frame (TakeShader and Update), and only after
+//it has been built successfully: a shader with errors leaves the last good program in use.
+//the time from noticing the change until the first frame drawn with the new version has been submitted is printed, since that is
+//how long an edit takes to show up.
+class HotReloader
+{
+public:
+	typedef size_t ShaderSlot;
+
+	//must be called on the main thread with the main context current. textures is where watched textures live
+	HotReloader(GLFWwindow* window, TextureLoader* textures)
+		: textures(textures), quit(false), started(false)
+	{
+		//the hidden window only exists to own a context. it inherits the version and profile hints of the main window
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+		this->context = glfwCreateWindow(1, 1, "Hot reload", nullptr, window);
+		glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+		if (this->context == nullptr)
+			std::cout << "ERROR::HOT_RELOAD::CONTEXT_CREATION_FAILED shaders will not be reloaded" << std::endl;
+	};
+	~HotReloader()
+	{
+		this->quit = true;
+		if (this->started)
+			this->thread.join();
+		for (size_t i = 0; i < this->shaders.size(); i++)
+		{
+			if (this->shaders[i].ready != nullptr)
+			{
+				GLState::Current().DeleteProgram(this->shaders[i].ready->Program);
+				delete this->shaders[i].ready;
+			}
+		}
+		if (this->context != nullptr)
+			glfwDestroyWindow(this->context);
+	};
+
+	//the Watch functions have to be called before Start
+	ShaderSlot WatchShader(const std::string& vertexPath, const std::string& fragmentPath)
+	{
+		ShaderEntry entry;
+		entry.vertexPath = vertexPath;
+		entry.fragmentPath = fragmentPath;
+		entry.ready = nullptr;
+		this->shaders.push_back(entry);
+		this->watcher.Watch(vertexPath);
+		this->watcher.Watch(fragmentPath);
+		return this->shaders.size() - 1;
+	};
+	void WatchTexture(TextureLoader::Handle handle)
+	{
+		TextureEntry entry;
+		entry.handle = handle;
+		entry.path = this->textures->GetPath(handle);
+		entry.cookedPath = CookedTexture::CookedPath(entry.path);
+		this->watchedTextures.push_back(entry);
+		//re-cooking the texture counts as a change too
+		this->watcher.Watch(entry.path);
+		this->watcher.Watch(entry.cookedPath);
+	};
+	void Start()
+	{
+		this->started = true;
+		this->thread = std::thread(&HotReloader::ThreadLoop, this);
+	};
+
+	//call on the GL thread at the start of a frame. returns the rebuilt shader if one is ready, otherwise nullptr.
+	//the caller now owns it and replaces (and deletes) the shader it was using
+	Shader* TakeShader(ShaderSlot slot)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		ShaderEntry& entry = this->shaders[slot];
+		Shader* shader = entry.ready;
+		if (shader != nullptr)
+		{
+			entry.ready = nullptr;
+			Pending pending = { entry.changedPath, entry.changeTime, entry.buildMs, 0, 0 };
+			this->onScreen.push_back(pending);
+		}
+		return shader;
+	};
+	//call on the GL thread at the start of a frame, before TextureLoader::Update. queues the textures whose files changed
+	void Update()
+	{
+		std::deque<Pending> changed;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			changed.swap(this->changedTextures);
+		}
+		for (size_t i = 0; i < changed.size(); i++)
+		{
+			changed[i].load = this->textures->Reload(changed[i].handle);
+			this->pendingTextures.push_back(changed[i]);
+		}
+	};
+	//call after the frame has been submitted. reports every reload that made it into this frame
+	void EndFrame()
+	{
+		double now = Now();
+		for (size_t i = 0; i < this->onScreen.size(); i++)
+			std::cout << "Hot reload " << this->onScreen[i].path << ": rebuilt in " << this->onScreen[i].buildMs << " ms, on screen "
+				<< (now - this->onScreen[i].changeTime) << " ms after the change was detected" << std::endl;
+		this->onScreen.clear();
+		for (size_t i = 0; i < this->pendingTextures.size();)
+		{
+			Pending& pending = this->pendingTextures[i];
+			GLuint finished = this->textures->GetFinishedLoad(pending.handle);
+			if (finished >= pending.load)
+			{
+				//a newer change finished first and this load was dropped. the newer one reports itself
+				if (finished > pending.load)
+					std::cout << "Hot reload " << pending.path << ": replaced by a later change before it reached the screen" << std::endl;
+				//a file that no longer decodes (e.g. saved half way) leaves the old version on screen until it is fixed
+				else if (this->textures->HasFailed(pending.handle))
+					std::cout << "Hot reload " << pending.path << ": failed to load, still showing the previous version" << std::endl;
+				else
+					std::cout << "Hot reload " << pending.path << ": on screen " << (now - pending.changeTime) << " ms after the change was detected" << std::endl;
+				this->pendingTextures.erase(this->pendingTextures.begin() + i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	};
+
+private:
+	struct ShaderEntry
+	{
+		std::string vertexPath, fragmentPath;
+		//built on the reload thread and waiting to be taken by the GL thread
+		Shader* ready;
+		//the file whose change triggered the build
+		std::string changedPath;
+		double changeTime;
+		double buildMs;
+	};
+	struct TextureEntry
+	{
+		TextureLoader::Handle handle;
+		std::string path, cookedPath;
+	};
+	//a reload on its way to the screen
+	struct Pending
+	{
+		std::string path;
+		double changeTime;
+		double buildMs;
+		TextureLoader::Handle handle;
+		//id of the texture load this change started. a load that was already running when the file changed has a lower one,
+		//so it can't be mistaken for this one
+		GLuint load;
+	};
+
+	TextureLoader* textures;
+	FileWatcher watcher;
+	GLFWwindow* context;
+	std::thread thread;
+	std::atomic<bool> quit;
+	bool started;
+	std::vector<ShaderEntry> shaders;
+	std::vector<TextureEntry> watchedTextures;
+	//protects ShaderEntry::ready and changedTextures
+	std::mutex mutex;
+	std::deque<Pending> changedTextures;
+	//only used on the GL thread
+	std::vector<Pending> onScreen;
+	std::vector<Pending> pendingTextures;
+
+	//milliseconds on a steady clock
+	static double Now()
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	};
+
+	void ThreadLoop()
+	{
+		Profiler::Instance().SetThreadName("Hot reload");
+		if (this->context != nullptr)
+			glfwMakeContextCurrent(this->context);
+		while (!this->quit)
+		{
+			std::chrono::steady_clock::time_point firstSeen;
+			std::vector<std::string> changed = this->watcher.Wait(100, &firstSeen);
+			if (changed.empty())
+				continue;
+			double changeTime = std::chrono::duration<double, std::milli>(firstSeen.time_since_epoch()).count();
+			for (size_t i = 0; i < this->shaders.size(); i++)
+			{
+				ShaderEntry& entry = this->shaders[i];
+				for (size_t c = 0; c < changed.size(); c++)
+				{
+					if (changed[c] == entry.vertexPath || changed[c] == entry.fragmentPath)
+					{
+						this->RebuildShader(entry, changed[c], changeTime);
+						break;
+					}
+				}
+			}
+			for (size_t i = 0; i < this->watchedTextures.size(); i++)
+			{
+				for (size_t c = 0; c < changed.size(); c++)
+				{
+					if (changed[c] == this->watchedTextures[i].path || changed[c] == this->watchedTextures[i].cookedPath)
+					{
+						Pending pending = { this->watchedTextures[i].path, changeTime, 0.0, this->watchedTextures[i].handle, 0 };
+						std::lock_guard<std::mutex> lock(this->mutex);
+						this->changedTextures.push_back(pending);
+						break;
+					}
+				}
+			}
+		}
+		if (this->context != nullptr)
+			glfwMakeContextCurrent(nullptr);
+	};
+
+	//runs on the reload thread with the shared context current
+	void RebuildShader(ShaderEntry& entry, const std::string& changedPath, double changeTime)
+	{
+		if (this->context == nullptr)
+			return;
+		double start = Now();
+		//no program cache: a shader being edited would only fill it with binaries we never load again.
+		//the sources are read rather than mapped, since the editor may be rewriting them right now
+		Shader* shader = new Shader(entry.vertexPath.c_str(), entry.fragmentPath.c_str(), nullptr, true);
+		if (!shader->IsLinked())
+		{
+			std::cout << "Hot reload " << changedPath << ": build failed, keeping the last good program" << std::endl;
+			glDeleteProgram(shader->Program);
+			delete shader;
+			return;
+		}
+		//the main context only sees the finished program once this context is done with it
+		glFinish();
+		std::lock_guard<std::mutex> lock(this->mutex);
+		//a newer build replaces one the GL thread has not picked up yet
+		if (entry.ready != nullptr)
+		{
+			glDeleteProgram(entry.ready->Program);
+			delete entry.ready;
+		}
+		entry.ready = shader;
+		entry.changedPath = changedPath;
+		entry.changeTime = changeTime;
+		entry.buildMs = Now() - start;
+	};
+};
+
+#endif // HOT_RELOADER_H
@@ -0,0 +1,178 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//Spreads loops over a fixed set of worker threads.
+//ParallelFor cuts the range into chunks and deals them out to one queue per thread. every thread works through its own queue
+//from the back and, once that is empty, steals chunks from the front of the other queues. that keeps all threads busy even when
+//some chunks take longer than others, without a single shared queue every thread would be fighting over.
+//the thread calling ParallelFor is thread 0 and works on the loop too, so JobSystem(4) starts 3 extra threads.
+class JobSystem
+{
+public:
+	//called with a chunk [begin, end) and the index of the thread running it (0 to ThreadCount() - 1)
+	typedef std::function<void(size_t begin, size_t end, unsigned int thread)> RangeFunction;
+
+	//threadCount includes the calling thread. 0 uses one thread per core
+	JobSystem(unsigned int threadCount = 0)
+		: quit(false), generation(0)
+	{
+		if (threadCount == 0)
+			threadCount = std::thread::hardware_concurrency();
+		if (threadCount == 0)
+			threadCount = 1;
+		this->activeThreads = threadCount;
+		this->queues.resize(threadCount);
+		for (unsigned int i = 0; i < threadCount; i++)
+			this->queues[i] = new Queue();
+		for (unsigned int i = 1; i < threadCount; i++)
+			this->workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	};
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->wakeMutex);
+			this->quit = true;
+		}
+		this->wake.notify_all();
+		for (size_t i = 0; i < this->workers.size(); i++)
+			this->workers[i].join();
+		for (size_t i = 0; i < this->queues.size(); i++)
+			delete this->queues[i];
+	};
+	unsigned int ThreadCount() const
+	{
+		return (unsigned int)this->queues.size();
+	};
+	//limits ParallelFor to the first count threads (at least 1), e.g. to measure how a loop scales with the number of cores
+	void SetActiveThreads(unsigned int count)
+	{
+		this->activeThreads = count < 1 ? 1 : count > this->ThreadCount() ? this->ThreadCount() : count;
+	};
+	unsigned int ActiveThreads() const
+	{
+		return this->activeThreads;
+	};
+
+	//runs function over [0, count) in chunks of grain items and returns once every chunk is done. only call from one thread at a time
+	void ParallelFor(size_t count, size_t grain, const RangeFunction& function)
+	{
+		if (count == 0)
+			return;
+		if (grain == 0)
+			grain = 1;
+		unsigned int active = this->activeThreads;
+		std::atomic<size_t> remaining((count + grain - 1) / grain);
+		size_t chunk = 0;
+		for (size_t begin = 0; begin < count; begin += grain, chunk++)
+		{
+			Job job = { &function, begin, begin + grain < count ? begin + grain : count, &remaining };
+			Queue& queue = *this->queues[chunk % active];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(job);
+		}
+		if (active > 1)
+		{
+			{
+				std::lock_guard<std::mutex> lock(this->wakeMutex);
+				this->generation++;
+			}
+			this->wake.notify_all();
+		}
+		//help out until every chunk has finished, including the ones other threads are still running
+		while (remaining.load(std::memory_order_acquire) > 0)
+		{
+			if (!this->RunOne(0))
+				std::this_thread::yield();
+		}
+	};
+
+private:
+	struct Job
+	{
+		const RangeFunction* function;
+		size_t begin, end;
+		std::atomic<size_t>* remaining;
+	};
+	//a short mutex per queue. the owner and thieves only meet on the same queue when it is nearly empty
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<Queue*> queues;
+	std::vector<std::thread> workers;
+	std::atomic<unsigned int> activeThreads;
+	//workers sleep on wake until generation changes, which happens whenever new jobs are queued
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	bool quit;
+	unsigned long long generation;
+
+	//takes a job from the thread's own queue, or steals one, and runs it. false if there was nothing to do
+	bool RunOne(unsigned int thread)
+	{
+		Job job;
+		if (!this->PopOwn(thread, job) && !this->Steal(thread, job))
+			return false;
+		(*job.function)(job.begin, job.end, thread);
+		job.remaining->fetch_sub(1, std::memory_order_acq_rel);
+		return true;
+	};
+	bool PopOwn(unsigned int thread, Job& job)
+	{
+		Queue& queue = *this->queues[thread];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			return false;
+		job = queue.jobs.back();
+		queue.jobs.pop_back();
+		return true;
+	};
+	bool Steal(unsigned int thread, Job& job)
+	{
+		unsigned int count = this->ThreadCount();
+		for (unsigned int i = 1; i < count; i++)
+		{
+			Queue& queue = *this->queues[(thread + i) % count];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.jobs.empty())
+				continue;
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			return true;
+		}
+		return false;
+	};
+	void WorkerLoop(unsigned int thread)
+	{
+		unsigned long long seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(this->wakeMutex);
+				while (!this->quit && this->generation == seen)
+					this->wake.wait(lock);
+				if (this->quit)
+					return;
+				seen = this->generation;
+			}
+			//threads switched off by SetActiveThreads stay asleep so they don't take part in the measurement
+			if (thread >= this->activeThreads)
+				continue;
+			while (this->RunOne(thread))
+			{
+			}
+		}
+	};
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,168 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Read-only view of a whole file mapped into memory.
+//the OS pages the file in when we touch it, so there is no read() into a buffer of our own and no copy.
+//the data stays valid until the MappedFile is closed or destroyed.
+//a file that may be rewritten while we use it (one hot reload just saw change) should be opened with copy set: reading a mapping past
+//the end of a file that has been truncated meanwhile raises SIGBUS and kills the process. a copy can't change under us, and if the
+//file shrank while it was read, Size is what was actually read.
+class MappedFile
+{
+public:
+	MappedFile()
+		: data(nullptr), size(0), copied(false)
+#ifdef _WIN32
+		, file(INVALID_HANDLE_VALUE), mapping(NULL)
+#endif
+	{
+	};
+	~MappedFile()
+	{
+		this->Close();
+	};
+
+	//returns false if the file does not exist or can't be mapped. an empty file opens fine but has no data.
+	//with copy the file is read into memory of its own instead of being mapped
+	bool Open(const std::string& path, bool copy = false)
+	{
+		this->Close();
+#ifdef _WIN32
+		this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (this->file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(this->file, &fileSize))
+		{
+			this->Close();
+			return false;
+		}
+		this->size = (size_t)fileSize.QuadPart;
+		if (this->size == 0)
+			return true;
+		if (copy)
+		{
+			unsigned char* buffer = new unsigned char[this->size];
+			size_t total = 0;
+			DWORD count;
+			while (total < this->size && ReadFile(this->file, buffer + total, (DWORD)(this->size - total), &count, NULL) && count > 0)
+				total += count;
+			CloseHandle(this->file);
+			this->file = INVALID_HANDLE_VALUE;
+			return this->Copied(buffer, total);
+		}
+		this->mapping = CreateFileMappingA(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (this->mapping == NULL)
+		{
+			this->Close();
+			return false;
+		}
+		this->data = (const unsigned char*)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0)
+		{
+			close(fd);
+			return false;
+		}
+		this->size = (size_t)info.st_size;
+		if (this->size == 0)
+		{
+			close(fd);
+			return true;
+		}
+		if (copy)
+		{
+			unsigned char* buffer = new unsigned char[this->size];
+			size_t total = 0;
+			ssize_t count;
+			while (total < this->size && (count = read(fd, buffer + total, this->size - total)) > 0)
+				total += (size_t)count;
+			close(fd);
+			return this->Copied(buffer, total);
+		}
+		void* view = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		//the mapping keeps its own reference to the file, so the descriptor is not needed any more
+		close(fd);
+		this->data = view != MAP_FAILED ? (const unsigned char*)view : nullptr;
+#endif
+		if (this->data == nullptr)
+		{
+			this->Close();
+			return false;
+		}
+		return true;
+	};
+	void Close()
+	{
+		if (this->copied)
+		{
+			delete[] this->data;
+			this->data = nullptr;
+			this->copied = false;
+		}
+#ifdef _WIN32
+		if (this->data != nullptr)
+			UnmapViewOfFile(this->data);
+		if (this->mapping != NULL)
+			CloseHandle(this->mapping);
+		if (this->file != INVALID_HANDLE_VALUE)
+			CloseHandle(this->file);
+		this->mapping = NULL;
+		this->file = INVALID_HANDLE_VALUE;
+#else
+		if (this->data != nullptr)
+			munmap((void*)this->data, this->size);
+#endif
+		this->data = nullptr;
+		this->size = 0;
+	};
+	const unsigned char* Data() const { return this->data; };
+	size_t Size() const { return this->size; };
+
+private:
+	const unsigned char* data;
+	size_t size;
+	//data was read into a buffer of our own rather than mapped
+	bool copied;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+
+	//takes over a buffer read by Open. the file may have shrunk since its size was taken, so size is what was read
+	bool Copied(unsigned char* buffer, size_t size)
+	{
+		this->data = buffer;
+		this->size = size;
+		this->copied = true;
+		return true;
+	};
+
+	//a copy would unmap the same view twice
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,99 @@
+#ifndef MATH_BENCHMARK_H
+#define MATH_BENCHMARK_H
+
+#include "SimdMath.h"
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+//Times the SimdMath kernels on every path the CPU supports (--math-bench), for a range of object counts.
+//a small count shows the fixed cost and runs out of the caches, a large one is limited by memory bandwidth.
+//every path is also checked against the scalar one, so a faster kernel that computes something else does not go unnoticed.
+class MathBenchmark
+{
+public:
+	static void Run()
+	{
+		const size_t counts[] = { 10000, 100000, 1000000 };
+		const SimdMath::Path paths[] = { SimdMath::Scalar, SimdMath::Sse, SimdMath::Avx2 };
+		std::cout << "Math benchmark, best path on this CPU: " << SimdMath::Name(SimdMath::Best()) << std::endl;
+		for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+		{
+			size_t count = counts[c];
+			Mat4Array models, transformed, reference;
+			SphereArray spheres;
+			models.Resize(count);
+			transformed.Resize(count);
+			reference.Resize(count);
+			spheres.Resize(count);
+			//the same pseudo random objects every run: rotated and scattered over a 200 unit cube
+			unsigned int seed = 12345;
+			for (size_t i = 0; i < count; i++)
+			{
+				Vec3 position = { Random(seed) * 200.0f - 100.0f, Random(seed) * 200.0f - 100.0f, Random(seed) * 200.0f - 100.0f };
+				models.Set(i, Mat4::TranslateRotateY(position, Random(seed) * 6.283f));
+				spheres.Set(i, position, 0.5f + Random(seed));
+			}
+			//a camera in the middle sees roughly a tenth of the cube. it looks along no axis in particular, so the matrices
+			//have few zeros and the comparison with the scalar results below means something
+			Mat4 viewProjection = Mat4::Perspective(1.0f, 4.0f / 3.0f, 0.1f, 150.0f) * Mat4::LookAt(Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 1.0f, 0.3f, -2.0f }, Vec3{ 0.0f, 1.0f, 0.0f });
+			Frustum frustum = Frustum::FromMatrix(viewProjection);
+			std::vector<unsigned int> visible(count), referenceVisible(count);
+			SimdMath::Multiply(SimdMath::Scalar, viewProjection, models, reference);
+			size_t referenceCount = SimdMath::Cull(SimdMath::Scalar, frustum, spheres, &referenceVisible[0]);
+
+			double scalarMultiplyMs = 0.0, scalarCullMs = 0.0;
+			for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++)
+			{
+				SimdMath::Path path = paths[p];
+				if (!SimdMath::Supported(path))
+					continue;
+				double multiplyMs = Time(count, [&]() { SimdMath::Multiply(path, viewProjection, models, transformed); });
+				size_t visibleCount = 0;
+				double cullMs = Time(count, [&]() { visibleCount = SimdMath::Cull(path, frustum, spheres, &visible[0]); });
+				if (path == SimdMath::Scalar)
+				{
+					scalarMultiplyMs = multiplyMs;
+					scalarCullMs = cullMs;
+				}
+				//FMA rounds differently from a multiply and an add, so the results only have to be close. a sphere that
+				//touches a plane can come out on either side for the same reason
+				float maxError = 0.0f;
+				for (int e = 0; e < 16; e++)
+					for (size_t i = 0; i < count; i++)
+						maxError = std::fmax(maxError, std::fabs(transformed.Element(e)[i] - reference.Element(e)[i]));
+				std::cout << "  " << count << " objects, " << SimdMath::Name(path) << ": multiply " << multiplyMs << " ms (" << (multiplyMs * 1e6 / count)
+					<< " ns each, " << (scalarMultiplyMs / multiplyMs) << "x), cull " << cullMs << " ms (" << (cullMs * 1e6 / count) << " ns each, "
+					<< (scalarCullMs / cullMs) << "x), " << visibleCount << " visible, largest difference to scalar " << maxError
+					<< (visibleCount != referenceCount ? ", VISIBLE COUNT DIFFERS FROM SCALAR" : "") << std::endl;
+			}
+		}
+	};
+
+private:
+	//uniform in [0, 1)
+	static float Random(unsigned int& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) * (1.0f / 16777216.0f);
+	};
+	//best time of several runs in milliseconds. small counts are repeated more often so timer noise does not dominate
+	template<typename Function> static double Time(size_t count, Function function)
+	{
+		int runs = count >= 1000000 ? 10 : count >= 100000 ? 50 : 200;
+		double best = 1e30;
+		for (int run = 0; run < runs; run++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			function();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			if (ms < best)
+				best = ms;
+		}
+		return best;
+	};
+};
+
+#endif // MATH_BENCHMARK_H
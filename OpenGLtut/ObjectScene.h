@@ -0,0 +1,187 @@
+#ifndef OBJECT_SCENE_H
+#define OBJECT_SCENE_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//bindings go through the state cache so it stays in sync with GL
+#include "GLState.h"
+#include "Shader.h"
+#include "StreamBuffer.h"
+//matrices and culling for many objects at once
+#include "SimdMath.h"
+#include "Profiler.h"
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+//A field of spinning quads seen through a 3D camera (--objects N).
+//every frame the model matrices of all objects are built, multiplied with the camera's view-projection matrix and culled against the
+//view frustum, all with the SimdMath batch kernels. the model-view-projection matrices of the visible objects are written into a uniform
+//buffer which objects.vs reads with gl_InstanceID, so each group of up to ObjectsPerDraw objects takes a single instanced draw call.
+class ObjectScene
+{
+public:
+	//a uniform block only has to be 16KB in GL 3.3, which is 256 matrices. objects.vs declares its array with this size
+	static const GLuint ObjectsPerDraw = 256;
+
+	//time spent in each step and what came out of it, summed over every Draw
+	double UpdateMs;
+	double TransformMs;
+	double CullMs;
+	double UploadMs;
+	unsigned long long Visible;
+	unsigned long long DrawCalls;
+
+	//vbo and ebo hold the quad from Source.cpp (position, color and texture coordinates per vertex)
+	ObjectScene(size_t count, GLuint vbo, GLuint ebo, ProgramCache* cache)
+		: UpdateMs(0.0), TransformMs(0.0), CullMs(0.0), UploadMs(0.0), Visible(0), DrawCalls(0),
+		path(SimdMath::Best()), stream(GL_UNIFORM_BUFFER, ObjectsPerDraw * sizeof(Mat4))
+	{
+		//the quad VAO in Source.cpp also has the QuadBatch instance attributes, so these objects get their own
+		GLState& state = GLState::Current();
+		glGenVertexArrays(1, &this->vao);
+		state.BindVertexArray(this->vao);
+		state.BindBuffer(GL_ARRAY_BUFFER, vbo);
+		state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (GLvoid*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (GLvoid*)(3 * sizeof(GL_FLOAT)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (GLvoid*)(6 * sizeof(GL_FLOAT)));
+		glEnableVertexAttribArray(2);
+		state.BindVertexArray(0);
+
+		//same fragment shader as the quads, so the textures are mixed the same way
+		this->shader = nullptr;
+		this->ReplaceShader(new Shader("objects.vs", "shader.frag", cache));
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		this->offsetAlignment = alignment > 0 ? (size_t)alignment : 256;
+
+		//a square grid on the ground (y = 0), one unit between objects
+		this->columns = (size_t)ceil(sqrt((double)count));
+		this->positions.resize(count);
+		this->models.Resize(count);
+		this->transformed.Resize(count);
+		this->bounds.Resize(count);
+		this->visibleIndices.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			float x = (float)(i % this->columns) - (this->columns - 1) * 0.5f;
+			float z = (float)(i / this->columns) - (this->columns - 1) * 0.5f;
+			this->positions[i] = Vec3{ x, 0.0f, z };
+			//the quad is 1x1 around its center, so half its diagonal covers it however it is turned
+			this->bounds.Set(i, this->positions[i], 0.7072f);
+		}
+	};
+	~ObjectScene()
+	{
+		GLState::Current().DeleteVertexArray(this->vao);
+		GLState::Current().DeleteProgram(this->shader->Program);
+		delete this->shader;
+	};
+	//takes over a shader built from objects.vs and shader.frag (e.g. by hot reload) and deletes the one it was using.
+	//a new link can move the uniforms, so the samplers and the block binding are set up again
+	void ReplaceShader(Shader* shader)
+	{
+		if (this->shader != nullptr)
+		{
+			GLState::Current().DeleteProgram(this->shader->Program);
+			delete this->shader;
+		}
+		this->shader = shader;
+		this->shader->BindSampler("ourTexture1", 0);
+		this->shader->BindSampler("ourTexture2", 1);
+		//the block reads from uniform buffer binding 0, where Draw puts each group's matrices
+		GLuint block = glGetUniformBlockIndex(this->shader->Program, "ObjectMatrices");
+		if (block != GL_INVALID_INDEX)
+			glUniformBlockBinding(this->shader->Program, block, 0);
+	};
+	size_t Size() const
+	{
+		return this->positions.size();
+	};
+	SimdMath::Path GetPath() const
+	{
+		return this->path;
+	};
+
+	//draws every object in view. time is the animation time in seconds, aspect the width / height of the target.
+	//the textures are bound to units 0 and 1 by the caller, like for the quads
+	void Draw(float time, float aspect)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		//the camera circles the middle of the field, high enough to see a good part of it but never all of a large one
+		float extent = (float)this->columns * 0.5f;
+		float orbit = extent * 0.6f + 2.0f;
+		Vec3 eye = { orbit * cosf(time * 0.2f), 2.0f + extent * 0.3f, orbit * sinf(time * 0.2f) };
+		Mat4 viewProjection = Mat4::Perspective(0.785f, aspect, 0.1f, extent * 4.0f + 10.0f) * Mat4::LookAt(eye, Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 1.0f, 0.0f });
+		{
+			ProfileZone zone("Update objects");
+			for (size_t i = 0; i < this->positions.size(); i++)
+				this->models.Set(i, Mat4::TranslateRotateY(this->positions[i], time + i * 0.01f));
+		}
+		std::chrono::high_resolution_clock::time_point updateEnd = std::chrono::high_resolution_clock::now();
+		{
+			ProfileZone zone("Transform objects");
+			SimdMath::Multiply(this->path, viewProjection, this->models, this->transformed);
+		}
+		std::chrono::high_resolution_clock::time_point transformEnd = std::chrono::high_resolution_clock::now();
+		size_t visibleCount;
+		{
+			//the bounds are in world space, so the planes come from the view-projection matrix
+			ProfileZone zone("Cull objects");
+			visibleCount = SimdMath::Cull(this->path, Frustum::FromMatrix(viewProjection), this->bounds, &this->visibleIndices[0]);
+		}
+		std::chrono::high_resolution_clock::time_point cullEnd = std::chrono::high_resolution_clock::now();
+		this->UpdateMs += std::chrono::duration<double, std::milli>(updateEnd - start).count();
+		this->TransformMs += std::chrono::duration<double, std::milli>(transformEnd - updateEnd).count();
+		this->CullMs += std::chrono::duration<double, std::milli>(cullEnd - transformEnd).count();
+		this->Visible += visibleCount;
+		if (visibleCount == 0)
+			return;
+
+		ProfileZone zone("Draw objects", true);
+		//one std140 mat4 array per group, each group starting on an offset the uniform buffer binding accepts
+		size_t groupSize = ObjectsPerDraw * sizeof(Mat4);
+		size_t groupStride = (groupSize + this->offsetAlignment - 1) / this->offsetAlignment * this->offsetAlignment;
+		size_t groups = (visibleCount + ObjectsPerDraw - 1) / ObjectsPerDraw;
+		char* mapped = (char*)this->stream.Map(groups * groupStride);
+		for (size_t i = 0; i < visibleCount; i++)
+			this->transformed.CopyTo(this->visibleIndices[i], (float*)(mapped + (i / ObjectsPerDraw) * groupStride) + (i % ObjectsPerDraw) * 16);
+		this->stream.Unmap();
+		this->UploadMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cullEnd).count();
+
+		GLState& state = GLState::Current();
+		this->shader->Use();
+		state.BindVertexArray(this->vao);
+		for (size_t group = 0; group < groups; group++)
+		{
+			size_t first = group * ObjectsPerDraw;
+			GLsizei instances = (GLsizei)(visibleCount - first < ObjectsPerDraw ? visibleCount - first : ObjectsPerDraw);
+			//the range always covers the whole block (all ObjectsPerDraw matrices), also for a last group that is only partly filled.
+			//binding less than the block's size is undefined even if the shader never reads past the end. groupStride leaves room for it
+			state.BindBufferRange(GL_UNIFORM_BUFFER, 0, this->stream.Buffer(), this->stream.Offset() + group * groupStride, groupSize);
+			glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, instances);
+			this->DrawCalls++;
+		}
+		this->stream.Fence();
+	};
+
+private:
+	GLuint vao;
+	Shader* shader;
+	SimdMath::Path path;
+	StreamBuffer stream;
+	size_t offsetAlignment;
+	size_t columns;
+	std::vector<Vec3> positions;
+	//model matrices, model-view-projection matrices and world space bounding spheres, one entry per object
+	Mat4Array models;
+	Mat4Array transformed;
+	SphereArray bounds;
+	std::vector<unsigned int> visibleIndices;
+};
+
+#endif // OBJECT_SCENE_H
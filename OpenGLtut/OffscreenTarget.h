@@ -0,0 +1,93 @@
+#ifndef OFFSCREEN_TARGET_H
+#define OFFSCREEN_TARGET_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//bindings go through the state cache so it stays in sync with GL
+#include "GLState.h"
+//SOIL also has a function to save images, we use it to write out the rendered frame
+#include<SOIL.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+//Framebuffer object (FBO) we render into when there is no window to show the result in.
+//a FBO is a render target we create ourselves. we attach a renderbuffer to it as the color buffer and, once it is bound,
+//glClear and draw calls write into that renderbuffer instead of the window.
+class OffscreenTarget
+{
+public:
+	OffscreenTarget(GLsizei width, GLsizei height)
+		: width(width), height(height)
+	{
+		glGenRenderbuffers(1, &this->colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		//a depth buffer too, for the 3D --objects scene. the window's default framebuffer has one as well
+		glGenRenderbuffers(1, &this->depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glGenFramebuffers(1, &this->framebuffer);
+		GLState::Current().BindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::FRAMEBUFFER::NOT_COMPLETE" << std::endl;
+		GLState::Current().BindFramebuffer(GL_FRAMEBUFFER, 0);
+	};
+	~OffscreenTarget()
+	{
+		GLState::Current().DeleteFramebuffer(this->framebuffer);
+		glDeleteRenderbuffers(1, &this->colorBuffer);
+		glDeleteRenderbuffers(1, &this->depthBuffer);
+	};
+	//every draw after this goes into the offscreen buffer
+	void Bind()
+	{
+		GLState::Current().BindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glViewport(0, 0, this->width, this->height);
+	};
+	//copies the color buffer into the window's back buffer, so a windowed --dump run still shows what it draws.
+	//leaves the window bound for drawing
+	void BlitToWindow(GLsizei windowWidth, GLsizei windowHeight)
+	{
+		GLState::Current().BindFramebuffer(GL_READ_FRAMEBUFFER, this->framebuffer);
+		GLState::Current().BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, this->width, this->height, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		GLState::Current().BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	};
+	//reads the color buffer back and saves it. the format is picked from the extension: .bmp or .tga
+	bool Save(const std::string& path)
+	{
+		std::vector<unsigned char> pixels((size_t)this->width * this->height * 3);
+		GLState::Current().BindFramebuffer(GL_READ_FRAMEBUFFER, this->framebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, this->width, this->height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		GLState::Current().BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		//OpenGL's first row is the bottom of the image but image files start at the top
+		size_t rowSize = (size_t)this->width * 3;
+		std::vector<unsigned char> flipped(pixels.size());
+		for (GLsizei y = 0; y < this->height; y++)
+			std::copy(pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize, flipped.begin() + (this->height - 1 - y) * rowSize);
+		bool bmp = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bmp") == 0;
+		int type = bmp ? SOIL_SAVE_TYPE_BMP : SOIL_SAVE_TYPE_TGA;
+		if (!SOIL_save_image(path.c_str(), type, this->width, this->height, 3, &flipped[0]))
+		{
+			std::cout << "ERROR::FRAMEBUFFER::SAVE_FAILED " << path << std::endl;
+			return false;
+		}
+		return true;
+	};
+
+private:
+	GLsizei width, height;
+	GLuint framebuffer;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+};
+
+#endif // OFFSCREEN_TARGET_H
@@ -0,0 +1,335 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+//Records named time ranges ("zones") on the CPU and the GPU and writes them out as a Chrome trace (open it in chrome://tracing or ui.perfetto.dev).
+//- a CPU zone is timed with a high resolution clock from when a ProfileZone is created until it goes out of scope.
+//- a GPU zone puts a GL_TIMESTAMP query into the command stream at both ends. the results only arrive once the GPU gets there, so
+//  queries are double buffered: zones issued in one frame are read at the start of the frame after the next, when they are done.
+//  if the GPU is still not there, the zone is dropped instead of stalling the CPU.
+//- every thread writes into its own event buffer, so recording never takes a lock. only the first zone of a new thread and the export do.
+//recording is off until SetEnabled(true), so a normal run only pays for a branch per zone.
+class Profiler
+{
+public:
+	static Profiler& Instance()
+	{
+		static Profiler profiler;
+		return profiler;
+	};
+
+	void SetEnabled(bool enabled) { this->enabled = enabled; };
+	bool IsEnabled() const { return this->enabled; };
+	//name shown for the calling thread in the trace
+	void SetThreadName(const char* name)
+	{
+		if (this->enabled)
+			this->LocalBuffer()->name = name;
+	};
+	//nanoseconds since the profiler was created
+	long long Now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - this->start).count();
+	};
+
+	//adds a finished CPU zone to the calling thread's buffer. detail is copied, so it can be a temporary
+	void RecordCpu(const char* name, const char* detail, long long startNs, long long endNs)
+	{
+		this->LocalBuffer()->Push(name, detail, startNs, endNs);
+	};
+	//GPU zones are only allowed on the thread that owns the GL context. returns the index to pass to EndGpu
+	int BeginGpu(const char* name, const char* detail)
+	{
+		if (!this->gpuReady)
+			this->InitGpu();
+		QuerySet& set = this->sets[this->currentSet];
+		if (set.used == set.zones.size())
+		{
+			set.zones.push_back(GpuZone());
+			glGenQueries(2, set.zones.back().queries);
+		}
+		GpuZone& zone = set.zones[set.used];
+		zone.name = name;
+		CopyDetail(zone.detail, detail);
+		glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+		return (int)set.used++;
+	};
+	void EndGpu(int index)
+	{
+		glQueryCounter(this->sets[this->currentSet].zones[index].queries[1], GL_TIMESTAMP);
+	};
+
+	//call on the GL thread at the start of every frame. switches query sets and reads the set that is about to be reused
+	void BeginFrame()
+	{
+		if (!this->gpuReady)
+			return;
+		this->currentSet = 1 - this->currentSet;
+		this->Collect(this->sets[this->currentSet], false);
+	};
+
+	//writes every recorded event to path. call on the GL thread once rendering is done: any GPU zone still in flight is waited for
+	bool WriteChromeTrace(const std::string& path)
+	{
+		if (this->gpuReady)
+		{
+			this->Collect(this->sets[1 - this->currentSet], true);
+			this->Collect(this->sets[this->currentSet], true);
+		}
+		std::ofstream out(path.c_str(), std::ios::trunc);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		size_t events = 0, dropped = 0;
+		std::lock_guard<std::mutex> lock(this->buffersMutex);
+		for (size_t t = 0; t < this->buffers.size(); t++)
+		{
+			ThreadBuffer& buffer = *this->buffers[t];
+			out << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << Escape(buffer.name) << "\"}}";
+			first = false;
+			//events past count may be half written by their thread, so only read up to it
+			size_t count = buffer.count.load(std::memory_order_acquire);
+			char line[512];
+			for (size_t i = 0; i < count; i++)
+			{
+				const Event& e = buffer.events[i];
+				snprintf(line, sizeof(line), ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f", (unsigned)t,
+					Escape(e.name).c_str(), e.startNs / 1000.0, (e.endNs - e.startNs) / 1000.0);
+				out << line;
+				if (e.detail[0] != '\0')
+					out << ",\"args\":{\"detail\":\"" << Escape(e.detail) << "\"}";
+				out << "}";
+			}
+			events += count;
+			dropped += buffer.dropped.load(std::memory_order_relaxed);
+		}
+		out << "\n]}\n";
+		if (!out)
+		{
+			std::cout << "ERROR::PROFILER::TRACE_WRITE_FAILED " << path << std::endl;
+			return false;
+		}
+		std::cout << "Trace: " << events << " events written to " << path << " (" << dropped << " dropped because a buffer was full, "
+			<< this->gpuNotReady << " GPU zones dropped because the GPU had not reached them)" << std::endl;
+		return true;
+	};
+	//frees the query objects. call while the GL context still exists
+	void Shutdown()
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			for (size_t i = 0; i < this->sets[s].zones.size(); i++)
+				glDeleteQueries(2, this->sets[s].zones[i].queries);
+			this->sets[s].zones.clear();
+			this->sets[s].used = 0;
+		}
+		this->gpuReady = false;
+	};
+
+private:
+	//events each thread can hold. when a buffer is full new events are counted and dropped
+	static const size_t BufferCapacity = 1 << 15;
+	static const size_t DetailLength = 48;
+	struct Event
+	{
+		const char* name;
+		char detail[DetailLength];
+		long long startNs, endNs;
+	};
+	//written only by its own thread. count is published with release so the exporting thread sees complete events
+	struct ThreadBuffer
+	{
+		std::string name;
+		std::vector<Event> events;
+		std::atomic<size_t> count;
+		std::atomic<size_t> dropped;
+
+		ThreadBuffer() : events(BufferCapacity), count(0), dropped(0) {};
+		void Push(const char* name, const char* detail, long long startNs, long long endNs)
+		{
+			size_t index = this->count.load(std::memory_order_relaxed);
+			if (index >= this->events.size())
+			{
+				this->dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			Event& e = this->events[index];
+			e.name = name;
+			CopyDetail(e.detail, detail);
+			e.startNs = startNs;
+			e.endNs = endNs;
+			this->count.store(index + 1, std::memory_order_release);
+		};
+	};
+	struct GpuZone
+	{
+		const char* name;
+		char detail[DetailLength];
+		GLuint queries[2];
+	};
+	struct QuerySet
+	{
+		std::vector<GpuZone> zones;
+		size_t used;
+		QuerySet() : used(0) {};
+	};
+
+	bool enabled;
+	std::chrono::high_resolution_clock::time_point start;
+	std::vector<std::unique_ptr<ThreadBuffer> > buffers;
+	std::mutex buffersMutex;
+	//GPU zones are written into their own buffer so they show up as a separate "GPU" row in the trace
+	ThreadBuffer* gpuBuffer;
+	bool gpuReady;
+	QuerySet sets[2];
+	int currentSet;
+	//GL_TIMESTAMP counts from some point the driver picks. this is the GPU time that matches CPU time gpuBaseCpuNs
+	long long gpuBaseNs;
+	long long gpuBaseCpuNs;
+	size_t gpuNotReady;
+
+	Profiler()
+		: enabled(false), start(std::chrono::high_resolution_clock::now()), gpuBuffer(nullptr), gpuReady(false), currentSet(0),
+		gpuBaseNs(0), gpuBaseCpuNs(0), gpuNotReady(0)
+	{
+	};
+	Profiler(const Profiler&);
+	Profiler& operator=(const Profiler&);
+
+	ThreadBuffer* AddBuffer(const char* name)
+	{
+		std::lock_guard<std::mutex> lock(this->buffersMutex);
+		this->buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+		this->buffers.back()->name = name;
+		return this->buffers.back().get();
+	};
+	//the buffer of the calling thread, created the first time the thread records something
+	ThreadBuffer* LocalBuffer()
+	{
+		static thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+			buffer = this->AddBuffer("Thread");
+		return buffer;
+	};
+	void InitGpu()
+	{
+		this->gpuBuffer = this->AddBuffer("GPU");
+		//line the GPU clock up with ours. both are read here at (almost) the same moment
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		this->gpuBaseCpuNs = this->Now();
+		this->gpuBaseNs = gpuNow;
+		this->gpuReady = true;
+	};
+	//reads the results of a query set into the GPU buffer and empties it. only blocks if wait is true
+	void Collect(QuerySet& set, bool wait)
+	{
+		for (size_t i = 0; i < set.used; i++)
+		{
+			GpuZone& zone = set.zones[i];
+			if (!wait)
+			{
+				GLint available = 0;
+				glGetQueryObjectiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available)
+				{
+					this->gpuNotReady++;
+					continue;
+				}
+			}
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+			long long offset = this->gpuBaseCpuNs - this->gpuBaseNs;
+			this->gpuBuffer->Push(zone.name, zone.detail, (long long)begin + offset, (long long)end + offset);
+		}
+		set.used = 0;
+	};
+	static void CopyDetail(char* destination, const char* detail)
+	{
+		if (detail == nullptr)
+		{
+			destination[0] = '\0';
+			return;
+		}
+		strncpy(destination, detail, DetailLength - 1);
+		destination[DetailLength - 1] = '\0';
+	};
+	//JSON strings need quotes, backslashes (e.g. in Windows paths) and control characters escaped
+	static std::string Escape(const std::string& text)
+	{
+		std::string result;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			char c = text[i];
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+				result += c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				result += ' ';
+			}
+			else
+			{
+				result += c;
+			}
+		}
+		return result;
+	};
+};
+
+//Times the scope it lives in. e.g. ProfileZone zone("Draw", true); at the top of a function records a CPU and a GPU zone for the whole call.
+//End() closes the zone early for code that is not in its own scope.
+class ProfileZone
+{
+public:
+	ProfileZone(const char* name, bool gpu = false, const char* detail = nullptr)
+		: name(name), detail(detail), gpuIndex(-1), open(Profiler::Instance().IsEnabled())
+	{
+		if (!this->open)
+			return;
+		if (gpu)
+			this->gpuIndex = Profiler::Instance().BeginGpu(name, detail);
+		this->startNs = Profiler::Instance().Now();
+	};
+	~ProfileZone()
+	{
+		this->End();
+	};
+	void End()
+	{
+		if (!this->open)
+			return;
+		this->open = false;
+		Profiler& profiler = Profiler::Instance();
+		profiler.RecordCpu(this->name, this->detail, this->startNs, profiler.Now());
+		if (this->gpuIndex >= 0)
+			profiler.EndGpu(this->gpuIndex);
+	};
+
+private:
+	const char* name;
+	const char* detail;
+	int gpuIndex;
+	bool open;
+	long long startNs;
+
+	ProfileZone(const ProfileZone&);
+	ProfileZone& operator=(const ProfileZone&);
+};
+
+#endif // PROFILER_H
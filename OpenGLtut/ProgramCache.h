@@ -0,0 +1,132 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//cache entries are mapped instead of read
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+
+//On-disk cache of linked shader programs.
+//compiling and linking GLSL is slow, so after the first successful link we ask the driver for the program binary with glGetProgramBinary
+//and store it on disk. the next launch hands that binary straight back with glProgramBinary.
+//the binary is only valid for the same sources on the same driver, so the cache key is a hash of the sources, vendor, renderer and version strings.
+//the driver is still free to reject an old binary (after an update for example). in that case we simply compile again and overwrite the entry.
+class ProgramCache
+{
+public:
+	//number of programs restored from disk, compiled because there was no entry, and compiled because the driver rejected the entry
+	GLuint Hits;
+	GLuint Misses;
+	GLuint Rejected;
+
+	//directory should end with a path separator, or be empty for the working directory
+	ProgramCache(const std::string& directory = "")
+		: Hits(0), Misses(0), Rejected(0), directory(directory)
+	{
+		GLint formats = 0;
+		if (GLEW_ARB_get_program_binary)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		//a driver with no binary formats can't give us anything to cache
+		this->enabled = formats > 0;
+		if (this->enabled)
+		{
+			this->driverId = std::string((const char*)glGetString(GL_VENDOR)) + "\n" + (const char*)glGetString(GL_RENDERER) + "\n"
+				+ (const char*)glGetString(GL_VERSION);
+		}
+	};
+	bool IsEnabled() const { return this->enabled; };
+
+	//builds the cache key for a set of shader sources on the current driver. the sources don't have to be null terminated
+	unsigned long long Key(const char* vertexCode, size_t vertexLength, const char* fragmentCode, size_t fragmentLength) const
+	{
+		//FNV-1a. we only need something fast that changes whenever one of the inputs does
+		unsigned long long hash = 14695981039346656037ULL;
+		const char* parts[] = { vertexCode, fragmentCode, this->driverId.c_str() };
+		size_t lengths[] = { vertexLength, fragmentLength, this->driverId.size() };
+		for (int p = 0; p < 3; p++)
+		{
+			for (size_t i = 0; i < lengths[p]; i++)
+			{
+				hash ^= (unsigned char)parts[p][i];
+				hash *= 1099511628211ULL;
+			}
+			//separator so that moving text from one source to the next still changes the hash
+			hash ^= 0xff;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	};
+	//tries to restore a program from the cache. returns true if the driver accepted the binary and the program is linked
+	bool Load(unsigned long long key, GLuint program)
+	{
+		if (!this->enabled)
+			return false;
+		//the binary goes to the driver straight from the mapped file
+		MappedFile file;
+		GLenum format;
+		GLuint length;
+		if (!file.Open(this->PathFor(key)) || file.Size() < sizeof(format) + sizeof(length))
+		{
+			this->Misses++;
+			return false;
+		}
+		memcpy(&format, file.Data(), sizeof(format));
+		memcpy(&length, file.Data() + sizeof(format), sizeof(length));
+		if (length == 0 || file.Size() - sizeof(format) - sizeof(length) < length)
+		{
+			this->Misses++;
+			return false;
+		}
+		glProgramBinary(program, format, file.Data() + sizeof(format) + sizeof(length), (GLsizei)length);
+		GLint success;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			this->Rejected++;
+			return false;
+		}
+		this->Hits++;
+		return true;
+	};
+	//stores the binary of a linked program. the program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	void Store(unsigned long long key, GLuint program)
+	{
+		if (!this->enabled)
+			return;
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> binary(length);
+		GLenum format;
+		glGetProgramBinary(program, length, NULL, &format, &binary[0]);
+		std::ofstream file(this->PathFor(key).c_str(), std::ios::binary | std::ios::trunc);
+		GLuint size = (GLuint)length;
+		file.write((const char*)&format, sizeof(format));
+		file.write((const char*)&size, sizeof(size));
+		file.write(&binary[0], length);
+		if (!file)
+			std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << this->PathFor(key) << std::endl;
+	};
+
+private:
+	std::string directory;
+	std::string driverId;
+	bool enabled;
+
+	std::string PathFor(unsigned long long key) const
+	{
+		std::stringstream path;
+		path << this->directory << "program_" << std::hex << key << ".bin";
+		return path.str();
+	};
+};
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,156 @@
+#ifndef QUAD_BATCH_H
+#define QUAD_BATCH_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//bindings go through the state cache so repeated binds of the same VAO are dropped
+#include "GLState.h"
+//persistently mapped ring buffer the instance data is streamed through
+#include "StreamBuffer.h"
+//every draw shows up as a CPU and GPU zone in the trace
+#include "Profiler.h"
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+//Draws any number of textured quads with a single instanced draw call.
+//the quad itself (4 vertices and 6 indices) lives in the VAO we already set up. this class adds a second vertex buffer to that VAO
+//which holds one entry per quad: a 2D transform, the part of the texture to show and a tint color.
+//glVertexAttribDivisor tells OpenGL to advance those attributes once per instance instead of once per vertex,
+//so glDrawElementsInstanced draws the same 6 indices N times with a different transform each time.
+//the instance data changes every frame, so it is written into a triple-buffered StreamBuffer instead of a normal VBO.
+class QuadBatch
+{
+public:
+	//per-instance data. must match the instance attributes in shader.vs (locations 3 to 6)
+	struct Instance
+	{
+		//2x3 affine transform. row 0 and row 1, each is (x scale/rotation, y scale/rotation, translation)
+		GLfloat transform[6];
+		//(u, v, width, height) of the part of the texture to map on the quad. (0, 0, 1, 1) is the whole texture
+		GLfloat texRect[4];
+		//multiplied with the texture color in the fragment shader
+		GLfloat tint[4];
+	};
+	//draw calls issued since the counter was last reset, so the render loop can report draws per frame
+	GLuint DrawCalls;
+
+	//vao must already have the quad's vertex and element buffers bound. indexCount is the number of indices of one quad
+	QuadBatch(GLuint vao, GLsizei indexCount)
+		: DrawCalls(0), vao(vao), indexCount(indexCount), stream(GL_ARRAY_BUFFER, 64 * sizeof(Instance)), size(0)
+	{
+		GLState::Current().BindVertexArray(this->vao);
+		//transform rows, texture rect and tint. the attribute pointers are set in Draw because the offset changes every frame
+		for (GLuint attribute = 3; attribute <= 6; attribute++)
+		{
+			glEnableVertexAttribArray(attribute);
+			glVertexAttribDivisor(attribute, 1);
+		}
+		GLState::Current().BindVertexArray(0);
+	};
+	//time the CPU waited for the GPU to release a region of the instance stream, and bytes streamed so far
+	double FenceWaitMs() const
+	{
+		return this->stream.FenceWaitMs;
+	};
+	unsigned long long BytesUploaded() const
+	{
+		return this->stream.BytesUploaded;
+	};
+
+	//starts a new batch. quads added after this are drawn by the next Draw
+	void Begin()
+	{
+		this->instances.clear();
+	};
+	void Add(const Instance& instance)
+	{
+		this->instances.push_back(instance);
+	};
+	//convenience version for a quad that is scaled, rotated (in radians) and then moved to (x, y)
+	void Add(GLfloat x, GLfloat y, GLfloat scaleX, GLfloat scaleY, GLfloat rotation, const GLfloat texRect[4], const GLfloat tint[4])
+	{
+		this->instances.push_back(MakeInstance(x, y, scaleX, scaleY, rotation, texRect, tint));
+	};
+	static Instance MakeInstance(GLfloat x, GLfloat y, GLfloat scaleX, GLfloat scaleY, GLfloat rotation, const GLfloat texRect[4], const GLfloat tint[4])
+	{
+		GLfloat c = cos(rotation);
+		GLfloat s = sin(rotation);
+		Instance instance = {
+			{ c * scaleX, -s * scaleY, x,
+			  s * scaleX, c * scaleY, y },
+			{ texRect[0], texRect[1], texRect[2], texRect[3] },
+			{ tint[0], tint[1], tint[2], tint[3] }
+		};
+		return instance;
+	};
+	//quads in the batch that was uploaded last
+	size_t Size() const
+	{
+		return this->size;
+	};
+	//uploads the instance data and draws every quad of the batch. the shader program and textures should already be bound
+	void Draw()
+	{
+		if (this->instances.empty())
+			return;
+		this->Upload();
+		this->DrawRange(0, this->instances.size());
+		this->EndDraw();
+	};
+	//the steps of Draw, for drawing the batch in several ranges with different state in between (see RenderQueue).
+	//Upload copies all instances into the stream once, DrawRange draws count quads starting at first, EndDraw fences the stream
+	void Upload()
+	{
+		Instance* destination = this->Map(this->instances.size());
+		if (!this->instances.empty())
+			memcpy(destination, &this->instances[0], this->instances.size() * sizeof(Instance));
+		this->Unmap();
+	};
+	//instead of Begin, Add and Upload: returns where to write count instances in this frame's part of the stream, for callers that
+	//already hold their instances somewhere else and would otherwise copy them twice. call Unmap once they are written
+	Instance* Map(size_t count)
+	{
+		this->size = count;
+		//Map also binds the stream buffer to GL_ARRAY_BUFFER
+		return (Instance*)this->stream.Map((count == 0 ? 1 : count) * sizeof(Instance));
+	};
+	void Unmap()
+	{
+		this->stream.Unmap();
+	};
+	void DrawRange(size_t first, size_t count)
+	{
+		if (count == 0)
+			return;
+		ProfileZone zone("Draw", true);
+		//the VAO is left bound after drawing. with the state cache, unbinding it would only cost us a rebind next frame
+		GLState::Current().BindVertexArray(this->vao);
+		//point the instance attributes at the range's part of this frame's stream region. without base instance (GL 4.2) moving the
+		//pointers is how a draw starts at an instance other than 0. the pointers read the buffer bound to GL_ARRAY_BUFFER
+		GLState::Current().BindBuffer(GL_ARRAY_BUFFER, this->stream.Buffer());
+		GLsizei stride = sizeof(Instance);
+		const char* base = (const char*)0 + this->stream.Offset() + first * sizeof(Instance);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)base);
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(base + 3 * sizeof(GLfloat)));
+		glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(base + 6 * sizeof(GLfloat)));
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(base + 10 * sizeof(GLfloat)));
+		glDrawElementsInstanced(GL_TRIANGLES, this->indexCount, GL_UNSIGNED_INT, 0, (GLsizei)count);
+		this->DrawCalls++;
+	};
+	void EndDraw()
+	{
+		//fence the region so it is not overwritten before the GPU is done drawing from it
+		this->stream.Fence();
+	};
+
+private:
+	GLuint vao;
+	GLsizei indexCount;
+	StreamBuffer stream;
+	std::vector<Instance> instances;
+	size_t size;
+};
+
+#endif // QUAD_BATCH_H
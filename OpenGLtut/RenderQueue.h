@@ -0,0 +1,242 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//state changes between commands go through the state cache
+#include "GLState.h"
+//the commands are quads, replayed through the instanced batch
+#include "QuadBatch.h"
+#include "Profiler.h"
+
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+//Bump allocator. memory is handed out by moving a pointer forward and is all given back at once by Reset.
+//blocks are kept after Reset, so once a frame has reached its peak nothing is allocated any more.
+class LinearArena
+{
+public:
+	LinearArena(size_t blockSize = 64 * 1024)
+		: blockSize(blockSize), block(0), used(0)
+	{
+	};
+	~LinearArena()
+	{
+		for (size_t i = 0; i < this->blocks.size(); i++)
+			delete[] this->blocks[i];
+	};
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		for (;;)
+		{
+			if (this->block < this->blocks.size())
+			{
+				size_t offset = (this->used + alignment - 1) & ~(alignment - 1);
+				if (offset + size <= this->blockSize)
+				{
+					this->used = offset + size;
+					return this->blocks[this->block] + offset;
+				}
+				this->block++;
+				this->used = 0;
+				continue;
+			}
+			if (size > this->blockSize)
+				this->blockSize = size;
+			//new[] of char is aligned for any fundamental type
+			this->blocks.push_back(new char[this->blockSize]);
+		}
+	};
+	void Reset()
+	{
+		this->block = 0;
+		this->used = 0;
+	};
+
+private:
+	size_t blockSize;
+	std::vector<char*> blocks;
+	//block being allocated from and how much of it is used
+	size_t block;
+	size_t used;
+
+	LinearArena(const LinearArena&);
+	LinearArena& operator=(const LinearArena&);
+};
+
+//Records draw commands on any thread and replays them on the GL thread.
+//every recording thread writes into its own command buffer (an arena plus a list of sort keys), so recording needs no locks.
+//Submit merges the lists, sorts them by key and walks through them once: consecutive commands with the same program and texture
+//become one instanced draw, and the state only changes between those runs.
+//the key only decides the order. it is packed so sorting it groups by state first:
+//	bits 63-48 program sort id, 47-32 texture sort id, 31-0 sequence
+//sort ids come from SortId, which numbers the GL names used this frame 0, 1, 2... GL names themselves can be any size (every reloaded
+//texture gets a new, larger one), so they are never packed into the key. the commands keep the real names and those are what gets bound.
+//the sequence keeps commands with the same state in the order they were recorded in (e.g. object index), so the picture does not
+//depend on which thread recorded what.
+class RenderQueue
+{
+public:
+	struct DrawCommand
+	{
+		GLuint program;
+		GLuint texture;
+		QuadBatch::Instance instance;
+	};
+	struct SortEntry
+	{
+		unsigned long long key;
+		const DrawCommand* command;
+	};
+	class CommandBuffer
+	{
+	public:
+		//copies the command into the arena and remembers its key. program and texture (on unit 0) are GL names
+		void Draw(unsigned long long key, GLuint program, GLuint texture, const QuadBatch::Instance& instance)
+		{
+			DrawCommand* command = (DrawCommand*)this->arena.Allocate(sizeof(DrawCommand), alignof(DrawCommand));
+			command->program = program;
+			command->texture = texture;
+			command->instance = instance;
+			SortEntry entry = { key, command };
+			this->entries.push_back(entry);
+		};
+		void Reset()
+		{
+			this->arena.Reset();
+			this->entries.clear();
+		};
+
+	private:
+		friend class RenderQueue;
+		LinearArena arena;
+		std::vector<SortEntry> entries;
+	};
+
+	//time spent sorting and replaying and the draw calls they resulted in, summed over every Submit
+	double SortMs;
+	double ReplayMs;
+	unsigned long long Commands;
+	unsigned long long DrawCalls;
+
+	//one command buffer per recording thread
+	RenderQueue(unsigned int threadCount)
+		: SortMs(0.0), ReplayMs(0.0), Commands(0), DrawCalls(0), buffers(threadCount)
+	{
+	};
+	//programId and textureId are sort ids from SortId, not GL names. from the top: 16 bits program, 16 bits texture, 32 bits sequence.
+	//there is no VAO field: every quad is drawn with the same VAO
+	static unsigned long long MakeKey(GLuint programId, GLuint textureId, GLuint sequence)
+	{
+		return ((unsigned long long)(programId & 0xffff) << 48) | ((unsigned long long)(textureId & 0xffff) << 32) | sequence;
+	};
+	//a small number for a GL name, the same one for the whole frame. call on the GL thread before recording starts.
+	//the numbers start again at 0 after every Submit, so they stay small however large the names get
+	GLuint SortId(GLuint name)
+	{
+		//a frame only uses a handful of programs and textures, so a search is quicker than a hash map
+		for (size_t i = 0; i < this->sortNames.size(); i++)
+			if (this->sortNames[i] == name)
+				return (GLuint)i;
+		this->sortNames.push_back(name);
+		return (GLuint)this->sortNames.size() - 1;
+	};
+	CommandBuffer& GetBuffer(unsigned int thread)
+	{
+		return this->buffers[thread];
+	};
+	void ResetStats()
+	{
+		this->SortMs = 0.0;
+		this->ReplayMs = 0.0;
+		this->Commands = 0;
+		this->DrawCalls = 0;
+	};
+
+	//call on the GL thread once every recording thread is done. draws everything and empties the command buffers
+	void Submit(QuadBatch& batch)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		{
+			ProfileZone zone("Sort commands");
+			this->sorted.clear();
+			for (size_t i = 0; i < this->buffers.size(); i++)
+				this->sorted.insert(this->sorted.end(), this->buffers[i].entries.begin(), this->buffers[i].entries.end());
+			this->RadixSort();
+		}
+		std::chrono::high_resolution_clock::time_point sortEnd = std::chrono::high_resolution_clock::now();
+
+		{
+			ProfileZone zone("Replay commands");
+			//all instances are written straight from the command buffers into the stream in sorted order, each run of equal state
+			//is a range of it
+			QuadBatch::Instance* instances = batch.Map(this->sorted.size());
+			for (size_t i = 0; i < this->sorted.size(); i++)
+				instances[i] = this->sorted[i].command->instance;
+			batch.Unmap();
+			GLState& state = GLState::Current();
+			size_t runStart = 0;
+			for (size_t i = 1; i <= this->sorted.size(); i++)
+			{
+				const DrawCommand* first = this->sorted[runStart].command;
+				if (i < this->sorted.size() && this->sorted[i].command->program == first->program && this->sorted[i].command->texture == first->texture)
+					continue;
+				state.UseProgram(first->program);
+				state.BindTexture(0, first->texture);
+				batch.DrawRange(runStart, i - runStart);
+				this->DrawCalls++;
+				runStart = i;
+			}
+			batch.EndDraw();
+		}
+		this->Commands += this->sorted.size();
+		for (size_t i = 0; i < this->buffers.size(); i++)
+			this->buffers[i].Reset();
+		this->sortNames.clear();
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		this->SortMs += std::chrono::duration<double, std::milli>(sortEnd - start).count();
+		this->ReplayMs += std::chrono::duration<double, std::milli>(end - sortEnd).count();
+	};
+
+private:
+	std::vector<CommandBuffer> buffers;
+	std::vector<SortEntry> sorted;
+	std::vector<SortEntry> scratch;
+	//GL names seen by SortId this frame. the index is the sort id
+	std::vector<GLuint> sortNames;
+
+	//least significant digit first radix sort, 8 bits per pass. a byte that is the same in every key (most of the state bits,
+	//the top of the sequence) does not change the order, so that pass is skipped
+	void RadixSort()
+	{
+		size_t count = this->sorted.size();
+		if (count < 2)
+			return;
+		this->scratch.resize(count);
+		unsigned long long differing = 0;
+		for (size_t i = 1; i < count; i++)
+			differing |= this->sorted[i].key ^ this->sorted[0].key;
+		for (int shift = 0; shift < 64; shift += 8)
+		{
+			if (((differing >> shift) & 0xff) == 0)
+				continue;
+			size_t offsets[256] = {};
+			for (size_t i = 0; i < count; i++)
+				offsets[(this->sorted[i].key >> shift) & 0xff]++;
+			size_t total = 0;
+			for (int d = 0; d < 256; d++)
+			{
+				size_t bucket = offsets[d];
+				offsets[d] = total;
+				total += bucket;
+			}
+			for (size_t i = 0; i < count; i++)
+				this->scratch[offsets[(this->sorted[i].key >> shift) & 0xff]++] = this->sorted[i];
+			this->sorted.swap(this->scratch);
+		}
+	};
+};
+
+#endif // RENDER_QUEUE_H
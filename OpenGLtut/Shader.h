@@ -0,0 +1,272 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+//binding the program goes through the state cache so binding the same program again is free
+#include "GLState.h"
+//restores linked programs from disk instead of compiling them again
+#include "ProgramCache.h"
+//times the shader build for the trace
+#include "Profiler.h"
+//the shader sources are mapped instead of read
+#include "MappedFile.h"
+//need to add this otherwise cout is not found in std namespace
+#include <iostream>
+
+class Shader
+{
+public:
+	//The program id
+	GLuint Program;
+	//number of glUniform* calls sent to the driver and number of calls skipped because the value was already set.
+	//shared by all shaders so the render loop can report the totals per frame.
+	static GLuint UniformCallsIssued;
+	static GLuint UniformCallsSkipped;
+	//constructor reads and builds the shader. needs file paths of the source code that we can store on disk as simple text files.
+	//if a program cache is given, the linked program is restored from it when possible and stored in it after a fresh compile.
+	//without a cache the constructor does not touch the GL state cache, so it can also run on a thread with a shared context.
+	//copyFiles reads the sources instead of mapping them, for files that may be rewritten while we read them (see MappedFile).
+	Shader(const GLchar* vertexPath, const GLchar* fragmentPath, ProgramCache* cache = nullptr, bool copyFiles = false)
+		: linked(false)
+	{
+		ProfileZone zone("Shader build", false, vertexPath);
+		//the files are mapped and the driver reads the text straight out of the mapping. reading them through an ifstream into a
+		//stringstream, then into a string and handing over its c_str() made three copies of every file before the driver made its own.
+		//hot reload waits until a file has been left alone for a moment, but an editor can still start writing it again while we read,
+		//so it passes copyFiles and the sources are read instead
+		MappedFile vertexFile, fragmentFile;
+		if (!vertexFile.Open(vertexPath, copyFiles) || !fragmentFile.Open(fragmentPath, copyFiles))
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+		//a mapped file is not null terminated, so the lengths go to glShaderSource along with the text
+		const GLchar* vShaderCode = vertexFile.Size() > 0 ? (const GLchar*)vertexFile.Data() : "";
+		const GLchar* fShaderCode = fragmentFile.Size() > 0 ? (const GLchar*)fragmentFile.Data() : "";
+		GLint vShaderLength = (GLint)vertexFile.Size();
+		GLint fShaderLength = (GLint)fragmentFile.Size();
+		//1. try the program cache first. if the driver accepts the stored binary there is nothing left to compile
+		unsigned long long cacheKey = 0;
+		if (cache != nullptr && cache->IsEnabled())
+		{
+			cacheKey = cache->Key(vShaderCode, vShaderLength, fShaderCode, fShaderLength);
+			this->Program = glCreateProgram();
+			if (cache->Load(cacheKey, this->Program))
+			{
+				this->linked = true;
+				this->CacheUniformLocations();
+				return;
+			}
+			GLState::Current().DeleteProgram(this->Program);
+		}
+		//vertex shader can also be stored in a string and later compiled at run time
+		//shaders always begin with a version declaration
+		//vertex shader input is called as vertex attribute
+		//HW limits the number of VAs we can declare. GLSL guarantees 16 4-component wise
+		//below is 1 way to write a shader but there is a better way after that
+		//const GLchar *vertexShaderSource = "#version 330 core\n layout(location = 0) in vec3 position;\n void main()\n { gl_Position = vec4(position.x, position.y, position.z, 1.0);	}";
+		//Now since we have more data to pass to vertex shader, we have to update our shader code.
+		//const GLchar *vertexShaderSource = "#version 330 core\n layout(location = 0) in vec3 position;\n layout(location = 1) in vec3 color;\n out vec3 ourColor;\n void main()\n { gl_Position = vec4(position, 1.0);	\n ourColor = color;}";
+		//const GLchar* fragmentShaderSource = "#version 330 core\n in vec3 ourColor;\n out vec4 color;\n void main()\n { color = vec4(ourColor, 1.0f); }";
+
+		//2. Compile shaders
+		GLuint vertexShader, fragmentShader;
+		//create a variable to store the result of compilation
+		GLint success;
+		//create a storage container for error message (if any)
+		GLchar infoLog[512];
+		//create vertex and fragment shaders object referenced by an ID
+		vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		//bind the shader source to the vertex shader object. 2nd parameter is the number of strings we want to pass.
+		//the last one is the length of each string. NULL would mean they are null terminated
+		glShaderSource(vertexShader, 1, &vShaderCode, &vShaderLength);
+		glCompileShader(vertexShader);
+		//if we want to check the result of compilation, we can do it this way		
+		//check if compilation was successful
+		glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+		//if compilation failed, get the error message and print it
+		if (!success)
+		{
+			glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+			std::cout << "EROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+		}
+		//repeat the same steps for fragment shader
+		//The output of vertex shader should have the same name and type as the input of fragment shader so that they can be linked together.
+		//below line is an example of passing data from vertex shader to fragment shader.
+		//const GLchar* fragmentShaderSource = "#version 330 core\n in vec4 vertexColor;\n out vec4 color;\n void main()\n { color = vertexColor; }";
+		//another way to pass data from application to the shader. Uniforms are different from vertex attributes'
+		//uniforms are global. it is unique per SPO and can be accessed from any shader until its updated
+		//Notice how instead of taking color value from the output of vertex shader we are taking it from a uniform
+		//since we are not using the uniform in VS there is no need to define it there. 
+		glShaderSource(fragmentShader, 1, &fShaderCode, &fShaderLength);
+		glCompileShader(fragmentShader);
+		glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+		}
+		//Shader program object (SPO) is the final linked version of multiple shaders combined.
+		//to use the previously compiled shaders we have to link them to a SPO and activate the SPO
+		this->Program = glCreateProgram();
+		//next we need to attach both the compiled shaders to the SPO
+		glAttachShader(this->Program, vertexShader);
+		glAttachShader(this->Program, fragmentShader);
+		//tell the driver we are going to ask for the binary, otherwise it may not keep it around
+		if (cache != nullptr && cache->IsEnabled())
+			glProgramParameteri(this->Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		//finally link the shaders together. The output of one shader will the input of next
+		glLinkProgram(this->Program);
+		//get the status of linking. notice the differences
+		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		}
+		else if (cache != nullptr)
+		{
+			cache->Store(cacheKey, this->Program);
+		}
+		this->linked = success != 0;
+		//we can now delete the individual VS and FS because they are linked into the SPO
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		//finally look up every active uniform once so the render loop never has to call glGetUniformLocation
+		this->CacheUniformLocations();
+	};
+	//false if a shader failed to compile or the program failed to link. the program can't be used then
+	bool IsLinked() const { return this->linked; };
+	//use the program
+	void Use() {
+		GLState::Current().UseProgram(this->Program);
+	};
+	//returns the location of a uniform from the table built at link time. -1 if the uniform is not active in the program
+	GLint GetUniformLocation(const std::string& name) const
+	{
+		std::unordered_map<std::string, GLint>::const_iterator it = this->uniformLocations.find(name);
+		return it != this->uniformLocations.end() ? it->second : -1;
+	};
+	//typed setters. the program should be in use before calling them, just like glUniform*.
+	//the last value sent for each location is remembered and the GL call is skipped if nothing changed.
+	void SetInt(GLint location, GLint value)
+	{
+		UniformValue* cached = this->GetCachedValue(location);
+		//the uniform is not active in the program. GL would ignore the call, so it counts as skipped
+		if (cached == nullptr)
+		{
+			UniformCallsSkipped++;
+			return;
+		}
+		if (cached->valid && cached->i == value)
+		{
+			UniformCallsSkipped++;
+			return;
+		}
+		cached->valid = true;
+		cached->i = value;
+		glUniform1i(location, value);
+		UniformCallsIssued++;
+	};
+	void SetFloat(GLint location, GLfloat value)
+	{
+		this->SetVec4(location, value, 0.0f, 0.0f, 0.0f, 1);
+	};
+	void SetVec4(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+	{
+		this->SetVec4(location, x, y, z, w, 4);
+	};
+	void SetInt(const std::string& name, GLint value) { this->SetInt(this->GetUniformLocation(name), value); };
+	void SetFloat(const std::string& name, GLfloat value) { this->SetFloat(this->GetUniformLocation(name), value); };
+	void SetVec4(const std::string& name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) { this->SetVec4(this->GetUniformLocation(name), x, y, z, w); };
+	//samplers never change texture unit after linking so we assign them once here instead of every frame
+	void BindSampler(const std::string& name, GLint unit)
+	{
+		this->Use();
+		this->SetInt(name, unit);
+	};
+
+private:
+	bool linked;
+	//last value sent to a uniform location. floats and vectors share the same storage
+	struct UniformValue
+	{
+		bool valid;
+		GLint i;
+		GLfloat f[4];
+	};
+	//uniform name -> location
+	std::unordered_map<std::string, GLint> uniformLocations;
+	//indexed by uniform location
+	std::vector<UniformValue> uniformValues;
+
+	//walks the list of active uniforms of the linked program with glGetActiveUniform and builds the name -> location table
+	void CacheUniformLocations()
+	{
+		GLint count = 0, maxNameLength = 0;
+		glGetProgramiv(this->Program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(this->Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+		std::vector<GLchar> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+		for (GLint i = 0; i < count; i++)
+		{
+			GLint size;
+			GLenum type;
+			GLsizei length;
+			glGetActiveUniform(this->Program, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, &nameBuffer[0]);
+			std::string name(&nameBuffer[0], length);
+			//uniforms inside a uniform block have no location
+			GLint location = glGetUniformLocation(this->Program, name.c_str());
+			if (location < 0)
+				continue;
+			//arrays are reported as "name[0]". make them reachable by their plain name as well
+			if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+				this->uniformLocations[name.substr(0, name.size() - 3)] = location;
+			this->uniformLocations[name] = location;
+			if ((size_t)location + size > this->uniformValues.size())
+				this->uniformValues.resize(location + size);
+		}
+		UniformValue unset = {};
+		for (size_t i = 0; i < this->uniformValues.size(); i++)
+			this->uniformValues[i] = unset;
+	};
+	UniformValue* GetCachedValue(GLint location)
+	{
+		if (location < 0 || (size_t)location >= this->uniformValues.size())
+			return nullptr;
+		return &this->uniformValues[location];
+	};
+	void SetVec4(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w, int components)
+	{
+		UniformValue* cached = this->GetCachedValue(location);
+		//the uniform is not active in the program. GL would ignore the call, so it counts as skipped
+		if (cached == nullptr)
+		{
+			UniformCallsSkipped++;
+			return;
+		}
+		if (cached->valid && cached->f[0] == x && cached->f[1] == y && cached->f[2] == z && cached->f[3] == w)
+		{
+			UniformCallsSkipped++;
+			return;
+		}
+		cached->valid = true;
+		cached->f[0] = x;
+		cached->f[1] = y;
+		cached->f[2] = z;
+		cached->f[3] = w;
+		if (components == 1)
+			glUniform1f(location, x);
+		else
+			glUniform4f(location, x, y, z, w);
+		UniformCallsIssued++;
+	};
+};
+
+//header is only included from Source.cpp so the static counters can be defined here
+GLuint Shader::UniformCallsIssued = 0;
+GLuint Shader::UniformCallsSkipped = 0;
+
+#endif // SHADER_H
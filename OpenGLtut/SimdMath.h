@@ -0,0 +1,423 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+//the SSE and AVX2 kernels only exist on x86. everywhere else only the scalar versions are compiled
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_MATH_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+//MSVC compiles AVX2 intrinsics in any function. we only call them after checking the CPU has them
+#define SIMD_MATH_AVX2
+#else
+//GCC and clang need to be told which functions may use AVX2 and FMA, so the rest of the program still runs on any x86-64 CPU
+#define SIMD_MATH_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+//Small vector and matrix types. matrices are column major like OpenGL's: m[column * 4 + row]
+struct Vec3
+{
+	float x, y, z;
+};
+struct Vec4
+{
+	float x, y, z, w;
+};
+struct Mat4
+{
+	float m[16];
+
+	static Mat4 Identity()
+	{
+		Mat4 result = {};
+		result.m[0] = result.m[5] = result.m[10] = result.m[15] = 1.0f;
+		return result;
+	};
+	//fovY in radians
+	static Mat4 Perspective(float fovY, float aspect, float zNear, float zFar)
+	{
+		float f = 1.0f / tanf(fovY * 0.5f);
+		Mat4 result = {};
+		result.m[0] = f / aspect;
+		result.m[5] = f;
+		result.m[10] = (zFar + zNear) / (zNear - zFar);
+		result.m[11] = -1.0f;
+		result.m[14] = 2.0f * zFar * zNear / (zNear - zFar);
+		return result;
+	};
+	static Mat4 LookAt(const Vec3& eye, const Vec3& target, const Vec3& up)
+	{
+		Vec3 f = Normalize(Vec3{ target.x - eye.x, target.y - eye.y, target.z - eye.z });
+		Vec3 s = Normalize(Cross(f, up));
+		Vec3 u = Cross(s, f);
+		Mat4 result = Identity();
+		result.m[0] = s.x; result.m[4] = s.y; result.m[8] = s.z;
+		result.m[1] = u.x; result.m[5] = u.y; result.m[9] = u.z;
+		result.m[2] = -f.x; result.m[6] = -f.y; result.m[10] = -f.z;
+		result.m[12] = -(s.x * eye.x + s.y * eye.y + s.z * eye.z);
+		result.m[13] = -(u.x * eye.x + u.y * eye.y + u.z * eye.z);
+		result.m[14] = f.x * eye.x + f.y * eye.y + f.z * eye.z;
+		return result;
+	};
+	//rotation around the y axis (radians) followed by a move to position
+	static Mat4 TranslateRotateY(const Vec3& position, float angle)
+	{
+		float c = cosf(angle), s = sinf(angle);
+		Mat4 result = Identity();
+		result.m[0] = c; result.m[2] = -s;
+		result.m[8] = s; result.m[10] = c;
+		result.m[12] = position.x; result.m[13] = position.y; result.m[14] = position.z;
+		return result;
+	};
+	Mat4 operator*(const Mat4& b) const
+	{
+		Mat4 result;
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+				result.m[c * 4 + r] = this->m[r] * b.m[c * 4] + this->m[4 + r] * b.m[c * 4 + 1] + this->m[8 + r] * b.m[c * 4 + 2] + this->m[12 + r] * b.m[c * 4 + 3];
+		return result;
+	};
+
+	static Vec3 Cross(const Vec3& a, const Vec3& b)
+	{
+		return Vec3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	};
+	static Vec3 Normalize(const Vec3& v)
+	{
+		float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+		return Vec3{ v.x / length, v.y / length, v.z / length };
+	};
+};
+
+//Array of floats aligned for AVX, with room rounded up to a multiple of 8
+class AlignedFloats
+{
+public:
+	AlignedFloats() : memory(nullptr), data(nullptr), size(0) {};
+	~AlignedFloats() { delete[] this->memory; };
+	void Resize(size_t count)
+	{
+		delete[] this->memory;
+		size_t padded = (count + 7) & ~(size_t)7;
+		//8 extra floats so the start can be moved up to the next 32 byte boundary
+		this->memory = new float[padded + 8]();
+		this->data = (float*)(((size_t)this->memory + 31) & ~(size_t)31);
+		this->size = count;
+	};
+	float* Data() { return this->data; };
+	const float* Data() const { return this->data; };
+	size_t Size() const { return this->size; };
+
+private:
+	float* memory;
+	float* data;
+	size_t size;
+
+	AlignedFloats(const AlignedFloats&);
+	AlignedFloats& operator=(const AlignedFloats&);
+};
+
+//Many 4x4 matrices stored structure-of-arrays: element e of every matrix is in its own array, so 4 (SSE) or 8 (AVX2)
+//matrices can be worked on at once with each register holding the same element of different matrices.
+class Mat4Array
+{
+public:
+	void Resize(size_t count)
+	{
+		for (int e = 0; e < 16; e++)
+			this->elements[e].Resize(count);
+	};
+	size_t Size() const { return this->elements[0].Size(); };
+	float* Element(int e) { return this->elements[e].Data(); };
+	const float* Element(int e) const { return this->elements[e].Data(); };
+	void Set(size_t index, const Mat4& matrix)
+	{
+		for (int e = 0; e < 16; e++)
+			this->elements[e].Data()[index] = matrix.m[e];
+	};
+	Mat4 Get(size_t index) const
+	{
+		Mat4 matrix;
+		for (int e = 0; e < 16; e++)
+			matrix.m[e] = this->elements[e].Data()[index];
+		return matrix;
+	};
+	//writes one matrix column major, e.g. into a std140 uniform block
+	void CopyTo(size_t index, float* destination) const
+	{
+		for (int e = 0; e < 16; e++)
+			destination[e] = this->elements[e].Data()[index];
+	};
+
+private:
+	AlignedFloats elements[16];
+};
+
+//bounding spheres, structure-of-arrays like Mat4Array
+class SphereArray
+{
+public:
+	void Resize(size_t count)
+	{
+		this->x.Resize(count);
+		this->y.Resize(count);
+		this->z.Resize(count);
+		this->radius.Resize(count);
+	};
+	size_t Size() const { return this->x.Size(); };
+	void Set(size_t index, const Vec3& center, float r)
+	{
+		this->x.Data()[index] = center.x;
+		this->y.Data()[index] = center.y;
+		this->z.Data()[index] = center.z;
+		this->radius.Data()[index] = r;
+	};
+	AlignedFloats x, y, z, radius;
+};
+
+//the 6 planes of a view frustum as (a, b, c, d) with a * x + b * y + c * z + d >= 0 inside and (a, b, c) of unit length
+struct Frustum
+{
+	Vec4 planes[6];
+
+	//extracts the planes from a (view) projection matrix (Gribb and Hartmann). spheres are then tested in the space the matrix maps from
+	static Frustum FromMatrix(const Mat4& matrix)
+	{
+		const float* m = matrix.m;
+		Frustum frustum;
+		for (int i = 0; i < 6; i++)
+		{
+			//left/right use row 0, bottom/top row 1, near/far row 2. each one is row 3 plus or minus that row
+			int row = i / 2;
+			float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+			Vec4 plane = { m[3] + sign * m[row], m[7] + sign * m[4 + row], m[11] + sign * m[8 + row], m[15] + sign * m[12 + row] };
+			float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			frustum.planes[i] = Vec4{ plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+		}
+		return frustum;
+	};
+};
+
+//Batch kernels over Mat4Array and SphereArray. every kernel has a scalar version, which works one object at a time,
+//and SSE (4 objects per instruction) and AVX2 (8 objects) versions on x86. Best() picks the widest one the CPU runs.
+class SimdMath
+{
+public:
+	enum Path { Scalar, Sse, Avx2 };
+
+	static bool Supported(Path path)
+	{
+#ifdef SIMD_MATH_X86
+		if (path == Avx2)
+			return HasAvx2();
+		//SSE2 is part of x86-64 and every compiler targets it by default
+		return true;
+#else
+		return path == Scalar;
+#endif
+	};
+	static Path Best()
+	{
+		return Supported(Avx2) ? Avx2 : Supported(Sse) ? Sse : Scalar;
+	};
+	static const char* Name(Path path)
+	{
+		return path == Avx2 ? "AVX2" : path == Sse ? "SSE" : "scalar";
+	};
+
+	//out[i] = a * b[i] for every matrix in b. out must have the same size as b
+	static void Multiply(Path path, const Mat4& a, const Mat4Array& b, Mat4Array& out)
+	{
+		size_t done = 0;
+#ifdef SIMD_MATH_X86
+		if (path == Avx2)
+			done = MultiplyAvx2(a, b, out);
+		else if (path == Sse)
+			done = MultiplySse(a, b, out);
+#endif
+		//the scalar version also does the last few matrices that don't fill a whole register
+		for (size_t i = done; i < b.Size(); i++)
+			out.Set(i, a * b.Get(i));
+	};
+
+	//writes the index of every sphere that is at least partly inside the frustum into visible (room for spheres.Size()) and
+	//returns how many there are. indices come out in increasing order
+	static size_t Cull(Path path, const Frustum& frustum, const SphereArray& spheres, unsigned int* visible)
+	{
+		size_t done = 0, count = 0;
+#ifdef SIMD_MATH_X86
+		if (path == Avx2)
+			done = CullAvx2(frustum, spheres, visible, count);
+		else if (path == Sse)
+			done = CullSse(frustum, spheres, visible, count);
+#endif
+		for (size_t i = done; i < spheres.Size(); i++)
+		{
+			Vec3 center = { spheres.x.Data()[i], spheres.y.Data()[i], spheres.z.Data()[i] };
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++)
+			{
+				const Vec4& plane = frustum.planes[p];
+				inside = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w > -spheres.radius.Data()[i];
+			}
+			if (inside)
+				visible[count++] = (unsigned int)i;
+		}
+		return count;
+	};
+
+private:
+#ifdef SIMD_MATH_X86
+	static bool HasAvx2()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		//the OS also has to save the upper halves of the AVX registers on a context switch
+		if (!fma || !osxsave || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	};
+
+	//each kernel returns how many objects it did. the rest (fewer than a register's width) is left to the scalar code
+	static size_t MultiplySse(const Mat4& a, const Mat4Array& b, Mat4Array& out)
+	{
+		__m128 av[16];
+		for (int e = 0; e < 16; e++)
+			av[e] = _mm_set1_ps(a.m[e]);
+		size_t count = b.Size() & ~(size_t)3;
+		for (size_t i = 0; i < count; i += 4)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				__m128 b0 = _mm_load_ps(b.Element(c * 4) + i);
+				__m128 b1 = _mm_load_ps(b.Element(c * 4 + 1) + i);
+				__m128 b2 = _mm_load_ps(b.Element(c * 4 + 2) + i);
+				__m128 b3 = _mm_load_ps(b.Element(c * 4 + 3) + i);
+				for (int r = 0; r < 4; r++)
+				{
+					__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(av[r], b0), _mm_mul_ps(av[4 + r], b1)),
+						_mm_add_ps(_mm_mul_ps(av[8 + r], b2), _mm_mul_ps(av[12 + r], b3)));
+					_mm_store_ps(out.Element(c * 4 + r) + i, sum);
+				}
+			}
+		}
+		return count;
+	};
+	SIMD_MATH_AVX2 static size_t MultiplyAvx2(const Mat4& a, const Mat4Array& b, Mat4Array& out)
+	{
+		__m256 av[16];
+		for (int e = 0; e < 16; e++)
+			av[e] = _mm256_set1_ps(a.m[e]);
+		size_t count = b.Size() & ~(size_t)7;
+		for (size_t i = 0; i < count; i += 8)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				__m256 b0 = _mm256_load_ps(b.Element(c * 4) + i);
+				__m256 b1 = _mm256_load_ps(b.Element(c * 4 + 1) + i);
+				__m256 b2 = _mm256_load_ps(b.Element(c * 4 + 2) + i);
+				__m256 b3 = _mm256_load_ps(b.Element(c * 4 + 3) + i);
+				for (int r = 0; r < 4; r++)
+				{
+					__m256 sum = _mm256_mul_ps(av[r], b0);
+					sum = _mm256_fmadd_ps(av[4 + r], b1, sum);
+					sum = _mm256_fmadd_ps(av[8 + r], b2, sum);
+					sum = _mm256_fmadd_ps(av[12 + r], b3, sum);
+					_mm256_store_ps(out.Element(c * 4 + r) + i, sum);
+				}
+			}
+		}
+		return count;
+	};
+
+	static size_t CullSse(const Frustum& frustum, const SphereArray& spheres, unsigned int* visible, size_t& visibleCount)
+	{
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; p++)
+		{
+			planes[p][0] = _mm_set1_ps(frustum.planes[p].x);
+			planes[p][1] = _mm_set1_ps(frustum.planes[p].y);
+			planes[p][2] = _mm_set1_ps(frustum.planes[p].z);
+			planes[p][3] = _mm_set1_ps(frustum.planes[p].w);
+		}
+		__m128 zero = _mm_setzero_ps();
+		size_t count = spheres.Size() & ~(size_t)3;
+		for (size_t i = 0; i < count; i += 4)
+		{
+			__m128 x = _mm_load_ps(spheres.x.Data() + i);
+			__m128 y = _mm_load_ps(spheres.y.Data() + i);
+			__m128 z = _mm_load_ps(spheres.z.Data() + i);
+			__m128 negativeRadius = _mm_sub_ps(zero, _mm_load_ps(spheres.radius.Data() + i));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+					_mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+				inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+			}
+			//one bit per sphere
+			for (int mask = _mm_movemask_ps(inside); mask != 0; mask &= mask - 1)
+				visible[visibleCount++] = (unsigned int)(i + LowestBit(mask));
+		}
+		return count;
+	};
+	SIMD_MATH_AVX2 static size_t CullAvx2(const Frustum& frustum, const SphereArray& spheres, unsigned int* visible, size_t& visibleCount)
+	{
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; p++)
+		{
+			planes[p][0] = _mm256_set1_ps(frustum.planes[p].x);
+			planes[p][1] = _mm256_set1_ps(frustum.planes[p].y);
+			planes[p][2] = _mm256_set1_ps(frustum.planes[p].z);
+			planes[p][3] = _mm256_set1_ps(frustum.planes[p].w);
+		}
+		__m256 zero = _mm256_setzero_ps();
+		size_t count = spheres.Size() & ~(size_t)7;
+		for (size_t i = 0; i < count; i += 8)
+		{
+			__m256 x = _mm256_load_ps(spheres.x.Data() + i);
+			__m256 y = _mm256_load_ps(spheres.y.Data() + i);
+			__m256 z = _mm256_load_ps(spheres.z.Data() + i);
+			__m256 negativeRadius = _mm256_sub_ps(zero, _mm256_load_ps(spheres.radius.Data() + i));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m256 distance = _mm256_fmadd_ps(planes[p][0], x, planes[p][3]);
+				distance = _mm256_fmadd_ps(planes[p][1], y, distance);
+				distance = _mm256_fmadd_ps(planes[p][2], z, distance);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+			}
+			for (int mask = _mm256_movemask_ps(inside); mask != 0; mask &= mask - 1)
+				visible[visibleCount++] = (unsigned int)(i + LowestBit(mask));
+		}
+		return count;
+	};
+	static int LowestBit(int mask)
+	{
+		int bit = 0;
+		while ((mask & 1) == 0)
+		{
+			mask >>= 1;
+			bit++;
+		}
+		return bit;
+	};
+#endif
+};
+
+#endif // SIMD_MATH_H
@@ -6,137 +6,208 @@
 //GLFW provides windowing and user input functions.
 #include<GLFW\glfw3.h>
 
-#ifndef SHADER_H
-#define SHADER_H
+//drops bind and state calls that would set what is already set
+#include "GLState.h"
+//the shader class reads, compiles and links our vertex and fragment shaders
+#include "Shader.h"
+//decodes textures on worker threads and uploads them through a PBO. prefers block-compressed .tex files cooked offline
+#include "TextureLoader.h"
+//draws many quads with a single instanced draw call
+#include "QuadBatch.h"
+//CPU and GPU frame time statistics
+#include "FrameStats.h"
+//framebuffer object we render into in headless mode
+#include "OffscreenTarget.h"
+//frame rate limiting, fixed timestep simulation and input latency
+#include "FramePacer.h"
+//CPU and GPU zones written out as a Chrome trace
+#include "Profiler.h"
+//rebuilds shaders and textures when their files are edited
+#include "HotReloader.h"
+//worker threads record the scene into command buffers that are sorted and replayed here
+#include "JobSystem.h"
+#include "RenderQueue.h"
+//3D objects transformed and culled with SSE/AVX2, their matrices read from a uniform buffer
+#include "ObjectScene.h"
+#include "MathBenchmark.h"
+//allocation counts and peak memory use for the startup report
+#include "AssetIO.h"
 
-#include <string>
-#include <fstream>
-#include <sstream>
-//need to add this otherwise cout is not found in std namespace
-#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <new>
 
-class Shader
+//every operator new and delete in the program goes through these so AllocationStats can count them.
+//the nothrow versions call them by default. C++14 compilers call the sized deletes when they know the size, and -Wsized-deallocation
+//warns when a program replaces only some of them, so all of those are replaced. the C++17 aligned (std::align_val_t) forms are not:
+//they are only used for types aligned beyond what plain new gives, and there are none
+static void* CountedAllocate(size_t size)
 {
-public:
-	//The program id
-	GLuint Program;
-	//constructor reads and builds the shader. needs file paths of the source code that we can store on disk as simple text files.
-	Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
-	{
-		std::string vertexCode;
-		std::string fragmentCode;
-		std::ifstream vShaderFile;
-		std::ifstream fShaderFile;
-		//ensure ifstream objects can throw exceptions:
-		vShaderFile.exceptions(std::ifstream::badbit);
-		fShaderFile.exceptions(std::ifstream::badbit);
-		try
-		{
-			//open files
-			vShaderFile.open(vertexPath);
-			fShaderFile.open(fragmentPath);
-			std::stringstream vShaderStream, fShaderStream;
-			//read files's buffer content into streams
-			vShaderStream << vShaderFile.rdbuf();
-			fShaderStream << fShaderFile.rdbuf();
-			//close file handlers
-			vShaderFile.close();
-			fShaderFile.close();
-			//convert stream into GLchar array
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
-		}
-		catch (std::ifstream::failure e)
-		{
-			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
-		}
-		const GLchar* vShaderCode = vertexCode.c_str();
-		const GLchar* fShaderCode = fragmentCode.c_str();
-		//vertex shader can also be stored in a string and later compiled at run time
-		//shaders always begin with a version declaration
-		//vertex shader input is called as vertex attribute
-		//HW limits the number of VAs we can declare. GLSL guarantees 16 4-component wise
-		//below is 1 way to write a shader but there is a better way after that
-		//const GLchar *vertexShaderSource = "#version 330 core\n layout(location = 0) in vec3 position;\n void main()\n { gl_Position = vec4(position.x, position.y, position.z, 1.0);	}";
-		//Now since we have more data to pass to vertex shader, we have to update our shader code.
-		//const GLchar *vertexShaderSource = "#version 330 core\n layout(location = 0) in vec3 position;\n layout(location = 1) in vec3 color;\n out vec3 ourColor;\n void main()\n { gl_Position = vec4(position, 1.0);	\n ourColor = color;}";
-		//const GLchar* fragmentShaderSource = "#version 330 core\n in vec3 ourColor;\n out vec4 color;\n void main()\n { color = vec4(ourColor, 1.0f); }";
-
-		//2. Compile shaders
-		GLuint vertexShader, fragmentShader;
-		//create a variable to store the result of compilation
-		GLint success;
-		//create a storage container for error message (if any)
-		GLchar infoLog[512];
-		//create vertex and fragment shaders object referenced by an ID
-		vertexShader = glCreateShader(GL_VERTEX_SHADER);
-		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-		//bind the shader source to the vertex shader object. 2nd parameter is the number of strings we want to pass.
-		glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-		glCompileShader(vertexShader);
-		//if we want to check the result of compilation, we can do it this way		
-		//check if compilation was successful
-		glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-		//if compilation failed, get the error message and print it
-		if (!success)
-		{
-			glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-			std::cout << "EROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-		}
-		//repeat the same steps for fragment shader
-		//The output of vertex shader should have the same name and type as the input of fragment shader so that they can be linked together.
-		//below line is an example of passing data from vertex shader to fragment shader.
-		//const GLchar* fragmentShaderSource = "#version 330 core\n in vec4 vertexColor;\n out vec4 color;\n void main()\n { color = vertexColor; }";
-		//another way to pass data from application to the shader. Uniforms are different from vertex attributes'
-		//uniforms are global. it is unique per SPO and can be accessed from any shader until its updated
-		//Notice how instead of taking color value from the output of vertex shader we are taking it from a uniform
-		//since we are not using the uniform in VS there is no need to define it there. 
-		glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-		glCompileShader(fragmentShader);
-		glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-		if (!success)
-		{
-			glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-		}
-		//Shader program object (SPO) is the final linked version of multiple shaders combined.
-		//to use the previously compiled shaders we have to link them to a SPO and activate the SPO
-		this->Program = glCreateProgram();
-		//next we need to attach both the compiled shaders to the SPO
-		glAttachShader(this->Program, vertexShader);
-		glAttachShader(this->Program, fragmentShader);
-		//finally link the shaders together. The output of one shader will the input of next
-		glLinkProgram(this->Program);
-		//get the status of linking. notice the differences
-		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
-		if (!success)
-		{
-			glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-		}
-		//we can now delete the individual VS and FS because they are linked into the SPO
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
-	};
-	//use the program
-	void Use() {
-		glUseProgram(this->Program);
-	};
-};
-
-#endif // SHADER_H
+	AllocationStats::Count(size);
+	void* memory = malloc(size > 0 ? size : 1);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+	return memory;
+}
+static void CountedFree(void* memory)
+{
+	if (memory != nullptr)
+		AllocationStats::Frees.fetch_add(1, std::memory_order_relaxed);
+	free(memory);
+}
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void operator delete(void* memory) noexcept { CountedFree(memory); }
+void operator delete[](void* memory) noexcept { CountedFree(memory); }
+void operator delete(void* memory, size_t) noexcept { CountedFree(memory); }
+void operator delete[](void* memory, size_t) noexcept { CountedFree(memory); }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
 
-int main()
+int main(int argc, char* argv[])
 {
-	glfwInit();
+	//--quads N replaces the single quad with a grid of N quads so we can measure how the batch renderer scales
+	int quadCount = 0;
+	//--headless renders into an offscreen framebuffer without showing a window. used for benchmarks on machines without a display
+	bool headless = false;
+	//--frames N stops after N frames. 0 runs until the window is closed
+	int maxFrames = 0;
+	//--dump file saves the last frame as a .bmp or .tga image so it can be compared against a reference
+	const char* dumpPath = nullptr;
+	//--fps N limits the frame rate. 0 is uncapped. defaults to the display's refresh rate with a window and uncapped in headless mode
+	double targetFps = -1.0;
+	//--no-vsync stops the buffer swap from waiting for the display. without it vsync is on whenever the target rate is the refresh rate
+	bool noVsync = false;
+	//--frames-in-flight N stops the CPU from getting more than N frames ahead of the GPU (1 or 2). 0 disables it
+	int framesInFlight = 0;
+	//--pacing-bench runs the loop at several target rates and reports CPU utilisation and frame time jitter for each
+	bool pacingBench = false;
+	//--trace file records CPU and GPU zones for the whole run and writes them as a Chrome trace (chrome://tracing or ui.perfetto.dev)
+	const char* tracePath = nullptr;
+	//--hot-reload watches the shaders and textures and swaps in new versions when their files change
+	bool hotReload = false;
+	//--threads N is the number of threads recording the --quads scene, including this one. defaults to one per core
+	unsigned int recordThreads = 0;
+	//--record-bench draws the --quads scene (100000 quads by default) recorded by 1, 2, 4... threads and reports how the CPU time scales
+	bool recordBench = false;
+	//--objects N draws a field of N objects seen through a 3D camera instead of the quads, see ObjectScene.h
+	int objectCount = 0;
+	//--cook file... is the offline step: it compresses each image into a .tex file next to it and exits. the loader picks those up automatically
+	if (argc > 2 && strcmp(argv[1], "--cook") == 0)
+	{
+		int failed = 0;
+		for (int i = 2; i < argc; i++)
+			if (!CookedTexture::Cook(argv[i], CookedTexture::CookedPath(argv[i])))
+				failed++;
+		return failed == 0 ? 0 : -1;
+	}
+	//--math-bench times the matrix and culling kernels (scalar, SSE and AVX2) for 10k to 1M objects and exits. it needs no GL
+	if (argc > 1 && strcmp(argv[1], "--math-bench") == 0)
+	{
+		MathBenchmark::Run();
+		return 0;
+	}
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--quads") == 0 && i + 1 < argc)
+			quadCount = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--headless") == 0)
+			headless = true;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			maxFrames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+			dumpPath = argv[++i];
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+			targetFps = atof(argv[++i]);
+		else if (strcmp(argv[i], "--no-vsync") == 0)
+			noVsync = true;
+		else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+			framesInFlight = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--pacing-bench") == 0)
+			pacingBench = true;
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			tracePath = argv[++i];
+		else if (strcmp(argv[i], "--hot-reload") == 0)
+			hotReload = true;
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			recordThreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--record-bench") == 0)
+			recordBench = true;
+		else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+			objectCount = atoi(argv[++i]);
+	}
+	Profiler::Instance().SetEnabled(tracePath != nullptr);
+	Profiler::Instance().SetThreadName("Main thread");
+	//a headless run that never stops would be useless, so give it a default length
+	if (headless && maxFrames <= 0)
+		maxFrames = 500;
+	if (targetFps < 0.0 && headless)
+		targetFps = 0.0;
+	//target rates the pacing benchmark goes through. 0 is uncapped. each rate runs for benchSeconds
+	const double benchRates[] = { 30.0, 60.0, 120.0, 240.0, 0.0 };
+	const int benchRateCount = sizeof(benchRates) / sizeof(benchRates[0]);
+	const double benchSeconds = 2.0;
+	int benchRate = 0;
+	if (pacingBench)
+	{
+		targetFps = benchRates[0];
+		maxFrames = 0;
+	}
+	//each thread count of the recording benchmark runs for recordBenchFrames frames. the first recordBenchWarmup of them are not measured
+	const GLuint recordBenchFrames = 110;
+	const GLuint recordBenchWarmup = 10;
+	if (recordBench)
+	{
+		if (quadCount <= 0)
+			quadCount = 100000;
+		targetFps = 0.0;
+		maxFrames = 0;
+	}
+
+	ProfileZone windowZone("Window and context creation");
+	//render servers and CI machines have no X11 or Wayland display. glfwInit fails on those platforms without one, so hints given
+	//after it come too late
+	bool noDisplay = getenv("DISPLAY") == nullptr && getenv("WAYLAND_DISPLAY") == nullptr;
+#ifdef GLFW_PLATFORM_NULL
+	//GLFW 3.4 has a null platform that needs no window system at all. it has to be picked before glfwInit
+	if (headless && noDisplay)
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+	if (!glfwInit())
+	{
+		std::cout << "Failed to initialize GLFW";
+		if (noDisplay)
+			std::cout << (headless ? " (there is no display, --headless needs GLFW 3.4 to run without one)" : " (there is no display, try --headless)");
+		std::cout << std::endl;
+		return -1;
+	}
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+	if (headless)
+	{
+		//GLFW still needs a window to own the context but it never has to be shown
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+#ifdef GLFW_PLATFORM_NULL
+		//on the null platform the context comes from EGL on Mesa's surfaceless platform (EGL_PLATFORM_SURFACELESS_MESA). it renders
+		//with whatever GPU driver Mesa has, or llvmpipe on the CPU
+		if (noDisplay)
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#endif
+	}
 
 	GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", nullptr, nullptr);
+#ifdef GLFW_PLATFORM_NULL
+	if (window == nullptr && headless && noDisplay)
+	{
+		//not every Mesa build has surfaceless EGL. OSMesa renders in software and needs nothing else
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+		window = glfwCreateWindow(800, 600, "LearnOpenGL", nullptr, nullptr);
+	}
+#endif
 	if (window == nullptr)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
@@ -144,7 +215,21 @@ int main()
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
+	//with a window the target rate defaults to what the display shows. 60 if GLFW can't tell
+	int refreshRate = 60;
+	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+	const GLFWvidmode* videoMode = monitor != nullptr ? glfwGetVideoMode(monitor) : nullptr;
+	if (videoMode != nullptr && videoMode->refreshRate > 0)
+		refreshRate = videoMode->refreshRate;
+	if (targetFps < 0.0)
+		targetFps = refreshRate;
+	//when we aim for the refresh rate anyway, the swap waits for vsync and the picture doesn't tear. any other rate is paced by the
+	//frame pacer alone. the benchmarks measure the pacer, so they never use vsync
+	bool vsync = !headless && !noVsync && !pacingBench && !recordBench && fabs(targetFps - refreshRate) < 0.5;
+	glfwSwapInterval(vsync ? 1 : 0);
+	windowZone.End();
 
+	ProfileZone glewZone("GLEW init");
 	//setting glewexperimental to true ensures that glew uses more modern techniques for managing OpenGL functionality 
 	glewExperimental = GL_TRUE;
 	//Need to initialize GLEW before calling any openGL functions.
@@ -153,6 +238,7 @@ int main()
 		std::cout << "Failed to initialize GLEW" << std::endl;
 		return -1;
 	}
+	glewZone.End();
 
 	//for the sake of simplicity we are providing values in NDC. real applications wont necessarily have it and we will
 	//need to transform them to NDC in VS.
@@ -189,25 +275,25 @@ int main()
 	//};
 	
 	//loading the wooden container texture. We can write our own image loader functions but we are going to use a library for loading textures in OpenGL called SOIL
-	int width, height;
+	//int width, height;
 	//1st argument is the location of the image. 2nd and 3rd will be initialized by SOIL from the image's data. 4th is the numbers of channels image has. we'll leave it at 0.
 	//5th arg tells how to load the image. since we just want to RGB values we set to RGB.
-	unsigned char* image = SOIL_load_image("container.jpg", &width, &height, 0, SOIL_LOAD_RGB);
+	//unsigned char* image = SOIL_load_image("container.jpg", &width, &height, 0, SOIL_LOAD_RGB);
 	//next we are going to generate the texture. store the texture id in a varibale. function takes as input the number of textures we want to generate
-	GLuint texture1;
-	glGenTextures(1, &texture1);
+	//GLuint texture1;
+	//glGenTextures(1, &texture1);
 	//Now we need to bind this texture so any texture commands will configure this texture. we are binding it to the 2D texture target
-	glBindTexture(GL_TEXTURE_2D, texture1);
+	//glBindTexture(GL_TEXTURE_2D, texture1);
 	//Texture wrapping
 	//There are many ways to specify what to do when s and t values specified to sample the texture are outside the range.
 	//default is to repeat the texture. there are other modes like clamp to edge, clamp to border and mirrored repeat.
 	//below is an example of clamp to border where for values outside the range, a default border color is used.
-	float borderColor[] = { 1.0f, 1.0f, 0.0f, 1.0f };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+	//float borderColor[] = { 1.0f, 1.0f, 0.0f, 1.0f };
+	//glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 	//this function is used to specify which type of texture wrap we want to use and for which axis. we can specify different wrap for different axis.
 	//the 1st argument is the texture target. since we are using 2D texture, it is 2D. 2nd is the type of texture option for a axis. this is wrap. 3rd option is the type of wrap.
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 
 	//texture filtering
 	//texture coordinates are always between (0,0) and (1,1) but a texture image can be of any resolution.
@@ -234,34 +320,43 @@ int main()
 	//so instead of using the above function to set the mag and min filter we can use below function to specify filter for both textture sampling and mipmap level sampling
 	//we are setting the minification filter as linear filtering for texture sampling and linear interpolation between two closest mipmap levels.
 	//keep in mind that mipmaps are only used for minification filter because we need it only when we downscale textures. 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	//1st arg specifies the texture target. 1D and 3D texture targets are not affected. 2nd arg specifies the mipmap level we want the texture generated for. we set it to 0 or base level.
 	//3rd ar specifies the format we want to store the texture in. 4th and 5th tells the width and height we want to use for our texture. next arg should always be 0.
 	//7th and 8th ar specifies the format and data type of the source image. last is actual image data.
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+	//glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
 	//now our container texture is attached to the currently bound 2D texture object but it only has the base level of the image loaded.
 	//if we want to use mipmaps we have to manually specify the image for each mipmap level by incrementing the level in above function or we can use...
-	glGenerateMipmap(GL_TEXTURE_2D);
+	//glGenerateMipmap(GL_TEXTURE_2D);
 	//now it is a good practice to free the image memory and unbind the texture object.
-	SOIL_free_image_data(image);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	//SOIL_free_image_data(image);
+	//glBindTexture(GL_TEXTURE_2D, 0);
 	//what if we want to use more than 1 texture in our fragment shader? We use something called as texture units which the location assigned to the texture sampler
 	//when we bind a texture, by default, it is assigned to texture unit 0. we can bind multiple textures each to a differnt texture unit. the number of texture units is HW dependent 
 	//repeating the above steps but for texture2 now
-	image = SOIL_load_image("awesomeface.png", &width, &height, 0, SOIL_LOAD_RGB);
-	GLuint texture2;
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	//image = SOIL_load_image("awesomeface.png", &width, &height, 0, SOIL_LOAD_RGB);
+	//GLuint texture2;
+	//glGenTextures(1, &texture2);
+	//glBindTexture(GL_TEXTURE_2D, texture2);
+	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SOIL_free_image_data(image);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	//glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+	//glGenerateMipmap(GL_TEXTURE_2D);
+	//SOIL_free_image_data(image);
+	//glBindTexture(GL_TEXTURE_2D, 0);
+	//decoding the images one after the other on this thread makes startup time grow with every texture we add.
+	//the texture loader does exactly the steps above but decodes the images on worker threads and only uploads them here.
+	//until a texture is ready the loader hands out a placeholder, so the game loop can start drawing straight away.
+	TextureLoader* textureLoader = new TextureLoader();
+	float borderColor[] = { 1.0f, 1.0f, 0.0f, 1.0f };
+	TextureLoader::Handle texture1 = textureLoader->Load("container.jpg", GL_CLAMP_TO_BORDER, borderColor);
+	TextureLoader::Handle texture2 = textureLoader->Load("awesomeface.png", GL_CLAMP_TO_BORDER);
+	//the --quads scene alternates between the container and the wall, so its objects need two different states
+	TextureLoader::Handle texture3 = quadCount > 0 ? textureLoader->Load("wall.jpg", GL_CLAMP_TO_BORDER, borderColor) : texture1;
 	//now that the texture is bound we can start generating the texture
 	//vertex buffer object id
 	GLuint VBO;
@@ -269,6 +364,7 @@ int main()
 	GLuint VAO;
 	//element buffer object id. This is used to store the index elements in a buffer just like VBO
 	GLuint EBO;
+	ProfileZone bufferZone("Buffer setup", true);
 	glGenVertexArrays(1, &VAO);
 	//generate '1' buffer object which will hold the vertex data on GPUs memory. VBO is the unique ID of this buffer object.
 	glGenBuffers(1, &VBO);
@@ -279,15 +375,17 @@ int main()
 	//each time we want to draw them. this leads to lot of repeated and cumbersome code. OpenGL allows us to store the bind and attribute pointer statements in a vertex array object. 
 	//once saved in a vertex array object, we just need to bind the appropriate VAO and its state will be restored.
 	//to save the state we bind the VAO and then any vertex bind, attrib pointer and attrib pointer enable statements are stored in VAO until we unbind the VAO
-	glBindVertexArray(VAO);
+	//we go through the state cache for binds so it always knows what is bound
+	GLState& glState = GLState::Current();
+	glState.BindVertexArray(VAO);
 	//Next we need to bind this newly created buffer object to vertex buffer object target which is GL_ARRAY_BUFFER.
 	//OpenGL allows us to bind to several buffer objects at once as long as they are of different buffer types.
 	//After this point, any call we make to the GL_ARRAY_BUFFER target will be used to configure the currently bound buffer VBO.
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glState.BindBuffer(GL_ARRAY_BUFFER, VBO);
 	//copies the previously defined vertex data into vertex buffer memory. 4th argument says that the data will most likely not change at all or very rarely
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 	//just like VBO we need to bind EBO to element array buffer. this call will be saved in the VAO too so no need to redefine it everytime we want to use it.
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glState.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 	//so far we have stored our vertex data in GPU memory
 	//however, we have not specified how to interpret vertex data and connect the vertex data to the attributes(variables) in vertex shader
@@ -308,68 +406,354 @@ int main()
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (GLvoid*)(6 * sizeof(GL_FLOAT)));
 	glEnableVertexAttribArray(2);
 	//unbind the VAO. all statements between bind and unbind are now stored in the VAO.
-	glBindVertexArray(0);
+	glState.BindVertexArray(0);
+	bufferZone.End();
 	//below 3 lines are optional and used to check how many VAs are supported by HW
 	GLint nrAttributes;
 	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
 	std::cout << "Maximum number of vertex attributes supported: " << nrAttributes << std::endl;
+	//the batch adds a per-instance buffer to our VAO. every quad we want to draw is added to the batch and all of them are drawn with 1 draw call
+	QuadBatch* quadBatch = new QuadBatch(VAO, 6);
+	const GLfloat fullTexture[] = { 0.0f, 0.0f, 1.0f, 1.0f };
+	const GLfloat noTint[] = { 1.0f, 1.0f, 1.0f, 1.0f };
 	
-	Shader ourShader("shader.vs","shader.frag");
+	//the program cache keeps the linked program on disk so the next launch can skip compiling and linking.
+	//run the program twice to compare a cold start (cache miss) against a warm one (cache hit).
+	ProgramCache programCache;
+	double shaderStartTime = glfwGetTime();
+	unsigned long long shaderStartAllocations = AllocationStats::Allocations;
+	//a pointer because hot reloading can replace the shader while we run
+	Shader* ourShader = new Shader("shader.vs","shader.frag", &programCache);
+	std::cout << "Shader build: " << ((glfwGetTime() - shaderStartTime) * 1000.0) << " ms, " << (AllocationStats::Allocations - shaderStartAllocations)
+		<< " allocations (program cache " << (programCache.IsEnabled() ? "enabled" : "not supported")
+		<< ", hits: " << programCache.Hits << ", misses: " << programCache.Misses << ", rejected: " << programCache.Rejected << ")" << std::endl;
+	//Using below function we can assign a location value to the texture sampler and specify which uniform sampler corresponds to which TU.
+	//the TU of a sampler never changes so we only have to do this once after linking instead of every frame.
+	//texture 1 is on TU 0 and texture 2 is on TU 1.
+	ourShader->BindSampler("ourTexture1", 0);
+	ourShader->BindSampler("ourTexture2", 1);
+	//the reloader watches the files on a background thread. everything it rebuilds is swapped in at the start of a frame
+	HotReloader* hotReloader = nullptr;
+	HotReloader::ShaderSlot shaderSlot = 0, objectShaderSlot = 0;
+	if (hotReload)
+	{
+		hotReloader = new HotReloader(window, textureLoader);
+		shaderSlot = hotReloader->WatchShader("shader.vs", "shader.frag");
+		//the --objects scene has its own vertex shader
+		if (objectCount > 0)
+			objectShaderSlot = hotReloader->WatchShader("objects.vs", "shader.frag");
+		hotReloader->WatchTexture(texture1);
+		hotReloader->WatchTexture(texture2);
+		if (texture3 != texture1)
+			hotReloader->WatchTexture(texture3);
+		hotReloader->Start();
+	}
 	glViewport(0, 0, 800, 600);
+	//the pacer waits for the start of each frame and tells us how many fixed simulation steps to run
+	FramePacer* pacer = new FramePacer(targetFps, 60.0, framesInFlight);
+	pacer->SetVsync(vsync);
+	//the key callback is a plain function, so we hand it the pacer through the window's user pointer to timestamp input
+	glfwSetWindowUserPointer(window, pacer);
 	glfwSetKeyCallback(window, key_callback);
 	//set opengl state to draw in wireframe mode. any subsequent draw calls will be affected.
 	//1st argument tells to apply it to front and back of all triangles.
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	//in headless mode every frame is drawn into this framebuffer instead of the window
+	OffscreenTarget* offscreen = nullptr;
+	if (headless || dumpPath != nullptr)
+		offscreen = new OffscreenTarget(800, 600);
+	//frame counter and start time so we can report frame times and uniform calls per frame when the window is closed
+	FrameStats* frameStats = new FrameStats();
+	//the --quads scene is recorded by a job system into one command buffer per thread and replayed on this thread
+	JobSystem* jobs = nullptr;
+	RenderQueue* renderQueue = nullptr;
+	//time spent recording the scene, and the thread counts the recording benchmark goes through
+	double recordMs = 0.0;
+	std::vector<unsigned int> benchThreads;
+	size_t benchThread = 0;
+	GLuint benchThreadStart = 0;
+	double benchBaselineMs = 0.0;
+	//CPU time of the whole frame when the measured frames of the current thread count started
+	double benchFrameCpuStart = 0.0;
+	if (quadCount > 0)
+	{
+		jobs = new JobSystem(recordThreads);
+		renderQueue = new RenderQueue(jobs->ThreadCount());
+		if (recordBench)
+		{
+			for (unsigned int threads = 1; threads < jobs->ThreadCount(); threads *= 2)
+				benchThreads.push_back(threads);
+			benchThreads.push_back(jobs->ThreadCount());
+			jobs->SetActiveThreads(benchThreads[0]);
+			//scaling can only show up to the number of cores, so say how many there are
+			std::cout << "Recording benchmark: " << quadCount << " quads, " << std::thread::hardware_concurrency() << " cores, up to "
+				<< jobs->ThreadCount() << " threads" << std::endl;
+		}
+	}
+	//the objects use their own VAO and shader but the same quad and textures
+	ObjectScene* objectScene = nullptr;
+	if (objectCount > 0)
+	{
+		objectScene = new ObjectScene(objectCount, VBO, EBO, &programCache);
+		//the objects overlap on screen, so unlike the flat quads they need the depth test
+		glEnable(GL_DEPTH_TEST);
+	}
+	GLuint frameCount = 0;
+	double loopStartTime = glfwGetTime();
+	//CPU time spent building and submitting each frame, not counting the time we wait in glfwSwapBuffers
+	double frameCpuMs = 0.0;
+	//the animation is simulated in fixed steps. we keep the previous and the current state and draw something in between
+	double previousAnimationTime = 0.0, animationTime = 0.0;
+	//frame at which the current benchmark rate started
+	GLuint benchRateStart = 0;
+	//startup counts as done once every texture is on the GPU. that is when we report what it cost
+	bool startupReported = false;
 	//game loop. each loop is 1 frame
-	while (!glfwWindowShouldClose(window))
+	while (!glfwWindowShouldClose(window) && (maxFrames <= 0 || (int)frameCount < maxFrames))
 	{
+		//wait for the start of the frame before polling input so we act on the newest events
+		pacer->WaitForNextFrame();
+		Profiler::Instance().BeginFrame();
+		ProfileZone frameZone("Frame", true);
+		frameCount++;
+		frameStats->BeginFrame();
+		std::chrono::high_resolution_clock::time_point frameStart = std::chrono::high_resolution_clock::now();
+		if (offscreen != nullptr)
+			offscreen->Bind();
 		//poll for any user input events and call the appropriate function.
 		glfwPollEvents();
-		//set the defualt clear color
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+		//advance the simulation in fixed steps. it runs at the same speed no matter how fast we draw
+		for (int step = 0; step < pacer->SimulationSteps(); step++)
+		{
+			previousAnimationTime = animationTime;
+			animationTime += pacer->SimulationStep();
+		}
+		//swap in a shader that was rebuilt since the last frame. a new link can move the uniforms, so the setup above is done again
+		Shader* rebuiltShader = hotReloader != nullptr ? hotReloader->TakeShader(shaderSlot) : nullptr;
+		if (rebuiltShader != nullptr)
+		{
+			glState.DeleteProgram(ourShader->Program);
+			delete ourShader;
+			ourShader = rebuiltShader;
+			ourShader->BindSampler("ourTexture1", 0);
+			ourShader->BindSampler("ourTexture2", 1);
+		}
+		rebuiltShader = hotReloader != nullptr && objectScene != nullptr ? hotReloader->TakeShader(objectShaderSlot) : nullptr;
+		if (rebuiltShader != nullptr)
+			objectScene->ReplaceShader(rebuiltShader);
+		//queue textures whose files changed. they are decoded again and replace the old ones once uploaded
+		if (hotReloader != nullptr)
+			hotReloader->Update();
+		//upload any texture that finished decoding since the last frame
+		textureLoader->Update();
+		if (!startupReported && textureLoader->AllReady())
+		{
+			startupReported = true;
+			std::cout << "Startup: ready after " << (glfwGetTime() * 1000.0) << " ms, " << AllocationStats::Allocations << " allocations ("
+				<< (AllocationStats::Bytes / 1024) << " KB), " << AllocationStats::Frees << " frees, texture decode arenas "
+				<< (textureLoader->ArenaBytes() / 1024) << " KB (grown " << textureLoader->ArenaGrows() << " times), " << textureLoader->UploadsDeferred << " uploads deferred, peak RSS "
+				<< (AllocationStats::PeakResidentKB() / 1024.0) << " MB" << std::endl;
+		}
+		//set the defualt clear color. it never changes, so the state cache only sends it to GL on the first frame
+		glState.ClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 		//activate and use the SPO
 		//glClear needs the bit which specifies the buffer we want to clear
-		glClear(GL_COLOR_BUFFER_BIT);
-		ourShader.Use();
-		//Here we will update the uniform color in fragment shader to gradually change color over time
-		//first we retrieve the running time in seconds
-		GLfloat timeValue = glfwGetTime();
-		//then we vary the color in the range from 0.0 - 1.0 by using the sin function
-		GLfloat greenValue = (sin(timeValue) / 2) + 0.5;
-		//next we query for the location of uniform variable ourColor in fragment shader
-		GLint vertexColorLocation = glGetUniformLocation(ourShader.Program, "ourColor");
-		//lastly we set the uniform value to the varying green color. before updating the uniform the SPO should be in use
-		//notice that we are using a single color for all fragments in 1 frame because all fragments in the FS use the same color.
-		//what if we want different colors for different fragments? calculate new color value in fragment shader instead of gameloop 
-		glUniform4f(vertexColorLocation, 0.0f, greenValue, 0.0f, 1.0f);
+		glClear(objectScene != nullptr ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT);
+		ourShader->Use();
+		//the animations run on the simulated time, interpolated between the last 2 simulation steps
+		//GLfloat timeValue = glfwGetTime();
+		GLfloat timeValue = (GLfloat)(previousAnimationTime + (animationTime - previousAnimationTime) * pacer->Alpha());
 		//now we also need to bind our texture and it will be automatically assigned to the sampler in the fragment shader
-		//since we have 2 textures we have to activate the corresponding TU and specify which uniform sampler in FS corresponds to which TU
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		//Using below function we can assign a location value to the texture sampler and specify which uniform sampler corresponds to which TU.
-		glUniform1i(glGetUniformLocation(ourShader.Program, "ourTexture1"), 0);
+		//since we have 2 textures we have to activate the corresponding TU. the samplers were already pointed at TU 0 and 1 after linking.
+		//glActiveTexture(GL_TEXTURE0);
+		//glBindTexture(GL_TEXTURE_2D, texture1);
 		//same steps for texture unit 2 now.
-		//assign texture 2 to TU 1.
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-		glUniform1i(glGetUniformLocation(ourShader.Program, "ourTexture2"), 1);
+		//glActiveTexture(GL_TEXTURE1);
+		//glBindTexture(GL_TEXTURE_2D, texture2);
+		//the state cache does both steps but skips them when the TU already has the right texture, which is every frame once the textures are loaded
+		glState.BindTexture(0, textureLoader->GetTexture(texture1));
+		glState.BindTexture(1, textureLoader->GetTexture(texture2));
 		//bind the vertex array we want to use
-		glBindVertexArray(VAO);
+		//glBindVertexArray(VAO);
 		//draw primitives using currently active shader. 2nd argument specifies the starting index of the vertex array. last argument tells how many vertices we want to draw.
 		//glDrawArrays(GL_TRIANGLES, 0, 3);
 		//since we are now using elements to specify the order of drawing we use a differnt function to draw.
 		//2nd argument specifies the number of vertices we want to draw. 3rd argument is the type of indices which is int. 4th is the offset in the EBO
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-		//swap the current buffer with the finsih rendered new buffer
-		glfwSwapBuffers(window);
+		//glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		//drawing 1 object per draw call doesn't scale, so now every quad goes through the batch which binds the VAO and draws all of them at once.
+		if (objectScene != nullptr)
+		{
+			objectScene->Draw(timeValue, 800.0f / 600.0f);
+		}
+		else if (quadCount <= 0)
+		{
+			//our original quad: not moved, not scaled and showing the whole texture
+			quadBatch->Begin();
+			quadBatch->Add(0.0f, 0.0f, 1.0f, 1.0f, 0.0f, fullTexture, noTint);
+			quadBatch->Draw();
+		}
+		else
+		{
+			//lay the quads out in a square grid covering the screen and spin each one a little differently.
+			//the work for each object (placing it, culling it, working out its tint) is spread over the job system. every thread records
+			//into its own command buffer, which needs no GL and no locks. the commands are then sorted by state and drawn from here.
+			std::chrono::high_resolution_clock::time_point recordStart = std::chrono::high_resolution_clock::now();
+			int columns = (int)ceil(sqrt((double)quadCount));
+			GLfloat cell = 2.0f / columns;
+			GLfloat radius = cell * 0.9f * 0.7072f;
+			GLuint program = ourShader->Program;
+			GLuint containerTexture = textureLoader->GetTexture(texture1);
+			GLuint wallTexture = textureLoader->GetTexture(texture3);
+			//the keys sort by small ids instead of the GL names. they are handed out here because the workers must not change the table
+			GLuint programId = renderQueue->SortId(program);
+			GLuint containerId = renderQueue->SortId(containerTexture);
+			GLuint wallId = renderQueue->SortId(wallTexture);
+			ProfileZone recordZone("Record commands");
+			jobs->ParallelFor(quadCount, 1024, [&](size_t begin, size_t end, unsigned int thread)
+			{
+				RenderQueue::CommandBuffer& commands = renderQueue->GetBuffer(thread);
+				for (size_t i = begin; i < end; i++)
+				{
+					int column = (int)(i % columns), row = (int)(i / columns);
+					GLfloat x = -1.0f + cell * (column + 0.5f);
+					GLfloat y = -1.0f + cell * (row + 0.5f);
+					//skip quads whose bounding circle is completely off screen
+					if (fabs(x) - radius > 1.0f || fabs(y) - radius > 1.0f)
+						continue;
+					//every object pulses at its own phase, like the green value of the single quad
+					GLfloat pulse = (GLfloat)(sin(timeValue * 2.0f + i * 0.37f) / 2) + 0.5f;
+					GLfloat tint[] = { 1.0f, 0.75f + 0.25f * pulse, 1.0f, 1.0f };
+					bool container = (row + column) % 2 == 0;
+					commands.Draw(RenderQueue::MakeKey(programId, container ? containerId : wallId, (GLuint)i), program, container ? containerTexture : wallTexture,
+						QuadBatch::MakeInstance(x, y, cell * 0.9f, cell * 0.9f, timeValue + i * 0.01f, fullTexture, tint));
+				}
+			});
+			recordZone.End();
+			recordMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+			renderQueue->Submit(*quadBatch);
+		}
+		frameCpuMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+		//headless runs never show the window, so there is nothing to swap. a windowed --dump run copies the offscreen frame into the window first
+		ProfileZone swapZone("Swap");
+		if (offscreen != nullptr)
+		{
+			if (headless)
+			{
+				glState.BindFramebuffer(GL_FRAMEBUFFER, 0);
+			}
+			else
+			{
+				GLint windowWidth, windowHeight;
+				glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+				offscreen->BlitToWindow(windowWidth, windowHeight);
+				glfwSwapBuffers(window);
+			}
+		}
+		else
+		{
+			//swap the current buffer with the finsih rendered new buffer
+			glfwSwapBuffers(window);
+		}
+		swapZone.End();
+		if (hotReloader != nullptr)
+			hotReloader->EndFrame();
+		pacer->EndFrame();
+		frameStats->EndFrame();
+		//the recording benchmark measures each thread count after a few warm-up frames, then moves on to the next
+		if (recordBench)
+		{
+			GLuint segmentFrames = frameCount - benchThreadStart;
+			if (segmentFrames == recordBenchWarmup)
+			{
+				recordMs = 0.0;
+				benchFrameCpuStart = frameCpuMs;
+				renderQueue->ResetStats();
+			}
+			else if (segmentFrames == recordBenchFrames)
+			{
+				GLuint measured = recordBenchFrames - recordBenchWarmup;
+				double sceneMs = (recordMs + renderQueue->SortMs + renderQueue->ReplayMs) / measured;
+				if (benchThread == 0)
+					benchBaselineMs = sceneMs;
+				std::cout << "Recording threads " << benchThreads[benchThread] << ": record " << (recordMs / measured) << " ms, sort "
+					<< (renderQueue->SortMs / measured) << " ms, replay " << (renderQueue->ReplayMs / measured) << " ms, scene CPU "
+					<< sceneMs << " ms per frame (" << (benchBaselineMs / sceneMs) << "x), " << ((double)renderQueue->Commands / measured)
+					<< " commands in " << ((double)renderQueue->DrawCalls / measured) << " draw calls, frame CPU "
+					<< ((frameCpuMs - benchFrameCpuStart) / measured) << " ms" << std::endl;
+				benchThreadStart = frameCount;
+				if (++benchThread == benchThreads.size())
+					break;
+				jobs->SetActiveThreads(benchThreads[benchThread]);
+			}
+		}
+		//move the pacing benchmark on to the next rate once the current one has run long enough
+		if (pacingBench)
+		{
+			double rate = benchRates[benchRate] > 0.0 ? benchRates[benchRate] : 120.0;
+			if (frameCount - benchRateStart >= (GLuint)(rate * benchSeconds))
+			{
+				pacer->Report();
+				benchRateStart = frameCount;
+				if (++benchRate == benchRateCount)
+					break;
+				pacer->SetTargetFps(benchRates[benchRate]);
+				pacer->ResetStats();
+			}
+		}
+	}
+	if (!pacingBench)
+		pacer->Report();
+	if (dumpPath != nullptr && offscreen != nullptr && offscreen->Save(dumpPath))
+		std::cout << "Saved last frame to " << dumpPath << std::endl;
+	if (frameCount > 0)
+	{
+		double elapsed = glfwGetTime() - loopStartTime;
+		frameStats->Report();
+		std::cout << "Uniform calls per frame: " << ((double)Shader::UniformCallsIssued / frameCount) << " issued, "
+			<< ((double)Shader::UniformCallsSkipped / frameCount) << " skipped" << std::endl;
+		std::cout << "State calls per frame: " << ((double)glState.CallsIssued / frameCount) << " issued, "
+			<< ((double)glState.CallsElided / frameCount) << " elided" << std::endl;
+		std::cout << "Quads: " << quadBatch->Size() << ", draw calls per frame: " << ((double)quadBatch->DrawCalls / frameCount)
+			<< ", CPU time per frame: " << (frameCpuMs / frameCount) << " ms" << std::endl;
+		std::cout << "Instance stream: " << (quadBatch->BytesUploaded() / (1024.0 * 1024.0 * elapsed)) << " MB/s uploaded, fence wait "
+			<< (quadBatch->FenceWaitMs() / frameCount) << " ms per frame" << std::endl;
+		if (renderQueue != nullptr && !recordBench)
+			std::cout << "Scene (" << jobs->ThreadCount() << " recording threads): " << ((double)renderQueue->Commands / frameCount) << " commands, record "
+				<< (recordMs / frameCount) << " ms, sort " << (renderQueue->SortMs / frameCount) << " ms, replay "
+				<< (renderQueue->ReplayMs / frameCount) << " ms per frame" << std::endl;
+		if (objectScene != nullptr)
+			std::cout << "Objects (" << SimdMath::Name(objectScene->GetPath()) << "): " << objectScene->Size() << ", visible " << (objectScene->Visible / frameCount)
+				<< ", draw calls " << ((double)objectScene->DrawCalls / frameCount) << ", update " << (objectScene->UpdateMs / frameCount) << " ms, transform "
+				<< (objectScene->TransformMs / frameCount) << " ms, cull " << (objectScene->CullMs / frameCount) << " ms, upload "
+				<< (objectScene->UploadMs / frameCount) << " ms per frame" << std::endl;
 	}
+	if (tracePath != nullptr)
+		Profiler::Instance().WriteChromeTrace(tracePath);
 
+	//the loader and the batch own GL objects (and the loader worker threads) so they have to go before the context does
+	delete frameStats;
+	delete pacer;
+	delete offscreen;
+	delete objectScene;
+	delete renderQueue;
+	delete jobs;
+	delete quadBatch;
+	//the reloader refers to the loader, so it goes first
+	delete hotReloader;
+	delete textureLoader;
+	glState.DeleteProgram(ourShader->Program);
+	delete ourShader;
+	Profiler::Instance().Shutdown();
 	glfwTerminate();
 	return 0;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
+	//remember when the input arrived so the pacer can report how long it took to reach the screen
+	FramePacer* pacer = (FramePacer*)glfwGetWindowUserPointer(window);
+	if (pacer != nullptr && action == GLFW_PRESS)
+		pacer->OnInput();
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+
+//bindings go through the state cache so it stays in sync with GL
+#include "GLState.h"
+
+#include <chrono>
+
+//Buffer for data that changes every frame (dynamic vertices, instance data).
+//uploading with glBufferData/glBufferSubData every frame makes the driver either allocate new storage or wait for the GPU to finish
+//with the old contents. instead this buffer is split into regionCount regions (3 by default, so triple buffered) and is mapped once
+//for its whole life with GL_MAP_PERSISTENT_BIT. every frame the CPU writes into the next region while the GPU can still be reading
+//the previous ones. a fence placed after the draw calls of a frame tells us when the GPU is done with that region, so we only ever
+//wait when the CPU gets more than regionCount frames ahead.
+class StreamBuffer
+{
+public:
+	//total time spent waiting on fences, and total bytes written, so the render loop can report stalls and upload throughput
+	double FenceWaitMs;
+	unsigned long long BytesUploaded;
+
+	//target is the binding point the buffer is used with, e.g. GL_ARRAY_BUFFER. regionSize is the starting size of one region,
+	//the buffer grows if a frame ever needs more
+	StreamBuffer(GLenum target, size_t regionSize, GLuint regionCount = 3)
+		: FenceWaitMs(0.0), BytesUploaded(0), target(target), buffer(0), regionSize(0), regionCount(regionCount), region(0), mapped(nullptr)
+	{
+		//persistent mapping is core in 4.4 but our context is 3.3, so we have to ask GLEW whether the driver has it
+		this->persistent = GLEW_ARB_buffer_storage != 0;
+		this->fences = new GLsync[regionCount];
+		for (GLuint i = 0; i < regionCount; i++)
+			this->fences[i] = 0;
+		this->Allocate(regionSize);
+	};
+	~StreamBuffer()
+	{
+		this->Release();
+		delete[] this->fences;
+	};
+
+	//returns where to write size bytes for this frame. the buffer is bound to the target
+	void* Map(size_t size)
+	{
+		if (size > this->regionSize)
+			this->Allocate(size);
+		this->WaitForRegion(this->region);
+		GLState::Current().BindBuffer(this->target, this->buffer);
+		this->BytesUploaded += size;
+		if (this->persistent)
+			return (char*)this->mapped + this->Offset();
+		//without persistent mapping we map just this region. unsynchronized is safe because the fence already told us the GPU is done with it
+		return glMapBufferRange(this->target, this->Offset(), size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	};
+	//offset in bytes of the region returned by the last Map. use it for attribute pointers or draw offsets until Fence is called
+	GLintptr Offset() const
+	{
+		return (GLintptr)(this->region * this->regionSize);
+	};
+	GLuint Buffer() const
+	{
+		return this->buffer;
+	};
+	//call when done writing, before drawing from the region. the buffer stays bound, whoever binds something else next will replace it
+	void Unmap()
+	{
+		//a buffer that is not persistently mapped can't be used by draw calls while it is mapped
+		if (!this->persistent)
+			glUnmapBuffer(this->target);
+	};
+	//call after issuing the draw calls that read this frame's region. fences the region and moves on to the next one
+	void Fence()
+	{
+		this->fences[this->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		this->region = (this->region + 1) % this->regionCount;
+	};
+
+private:
+	GLenum target;
+	GLuint buffer;
+	size_t regionSize;
+	GLuint regionCount;
+	//region the CPU writes this frame
+	GLuint region;
+	//start of the persistent mapping
+	void* mapped;
+	bool persistent;
+	//one fence per region. 0 means the GPU is not using the region
+	GLsync* fences;
+
+	void WaitForRegion(GLuint index)
+	{
+		if (this->fences[index] == 0)
+			return;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		//the first wait flushes so the fence is guaranteed to be signalled eventually
+		GLenum result = glClientWaitSync(this->fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(this->fences[index], 0, 1000000);
+		this->FenceWaitMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		glDeleteSync(this->fences[index]);
+		this->fences[index] = 0;
+	};
+	//(re)creates the buffer with room for regionCount regions of at least size bytes
+	void Allocate(size_t size)
+	{
+		this->Release();
+		//grow in powers of two so a slowly growing stream doesn't recreate the buffer every frame
+		size_t newSize = this->regionSize > 0 ? this->regionSize : 4096;
+		while (newSize < size)
+			newSize *= 2;
+		this->regionSize = newSize;
+		this->region = 0;
+		glGenBuffers(1, &this->buffer);
+		GLState::Current().BindBuffer(this->target, this->buffer);
+		if (this->persistent)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(this->target, this->regionSize * this->regionCount, NULL, flags);
+			this->mapped = glMapBufferRange(this->target, 0, this->regionSize * this->regionCount, flags);
+		}
+		else
+		{
+			glBufferData(this->target, this->regionSize * this->regionCount, NULL, GL_STREAM_DRAW);
+		}
+	};
+	//waits for the GPU to finish with every region and deletes the buffer
+	void Release()
+	{
+		if (this->buffer == 0)
+			return;
+		for (GLuint i = 0; i < this->regionCount; i++)
+			this->WaitForRegion(i);
+		if (this->mapped != nullptr)
+		{
+			GLState::Current().BindBuffer(this->target, this->buffer);
+			glUnmapBuffer(this->target);
+			this->mapped = nullptr;
+		}
+		GLState::Current().DeleteBuffer(this->buffer);
+		this->buffer = 0;
+	};
+};
+
+#endif // STREAM_BUFFER_H
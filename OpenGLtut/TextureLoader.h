@@ -0,0 +1,603 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+//GLEW manages function pointers to OpenGL.
+#include<GL\glew.h>
+//bindings go through the state cache so it stays in sync with GL
+#include "GLState.h"
+//Adding SOIL for loading textures in OpenGL
+#include<SOIL.h>
+//textures cooked offline into block-compressed files with all their mipmaps
+#include "CookedTexture.h"
+//decode and upload of every texture show up in the trace
+#include "Profiler.h"
+//to tell whether a cooked file is older than the image it was made from
+#include "FileWatcher.h"
+//image files are mapped, and decoded pixels wait for their upload in reusable arenas
+#include "AssetIO.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+//Loads textures without blocking the render loop.
+//decoding the image file is the slow part so it is done by a pool of worker threads. the GL thread only copies the decoded pixels
+//into one of a ring of pixel buffer objects (PBOs) and lets the driver upload them to the texture from there. a PBO is only reused once
+//the GPU has finished reading it; if none is free, the upload waits for a later frame instead of stalling this one.
+//until a texture is ready, its handle returns a small placeholder texture so the loop can start drawing straight away.
+//if an image has a cooked .tex file next to it (see CookedTexture), that is used instead: the worker only maps and checks the file
+//and the GL thread copies the compressed mipmaps from the mapping into a PBO and uploads them from there.
+//Reload decodes a texture again (e.g. after its file was edited). the old texture stays in use until the new one has been uploaded.
+//a reloaded file is read instead of mapped, because it may be rewritten again while the worker decodes it (see MappedFile).
+//image files are mapped and decoded from memory. SOIL still allocates a buffer of its own for every image it decodes (its API has no
+//way to pass one in), so the worker copies the pixels into an AssetArena taken from a pool and frees SOIL's buffer straight away.
+//the arena holds the pixels until they are in the PBO and then goes back to the pool. once every arena has held the largest image
+//the arenas stop growing, but each decode still costs SOIL's allocations.
+class TextureLoader
+{
+public:
+	typedef size_t Handle;
+
+	//uploads put off to a later frame because every PBO was still being read by the GPU
+	unsigned int UploadsDeferred;
+
+	//threadCount is the number of decode workers. 0 picks one less than the number of cores (at least 1).
+	TextureLoader(unsigned int threadCount = 0)
+		: UploadsDeferred(0), quit(false), nextStaging(0)
+	{
+		for (int i = 0; i < StagingCount; i++)
+		{
+			this->staging[i].pbo = 0;
+			this->staging[i].size = 0;
+			this->staging[i].mapped = nullptr;
+			this->staging[i].fence = 0;
+		}
+		//immutable storage and persistent mapping are core in 4.2 and 4.4 but our context is 3.3, so we have to ask GLEW whether the driver has them
+		this->hasTexStorage = GLEW_ARB_texture_storage != 0;
+		this->hasPersistentMapping = GLEW_ARB_buffer_storage != 0;
+		//S3TC is not part of core GL (it was patented), but nearly every desktop driver has it
+		this->hasS3TC = GLEW_EXT_texture_compression_s3tc != 0;
+		this->CreatePlaceholder();
+		if (threadCount == 0)
+		{
+			unsigned int cores = std::thread::hardware_concurrency();
+			threadCount = cores > 1 ? cores - 1 : 1;
+		}
+		for (unsigned int i = 0; i < threadCount; i++)
+			this->workers.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+	};
+	~TextureLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->queueMutex);
+			this->quit = true;
+		}
+		this->queueCondition.notify_all();
+		for (size_t i = 0; i < this->workers.size(); i++)
+			this->workers[i].join();
+		//free any image that was decoded but never uploaded. its pixels are in an arena, which belongs to the pool
+		for (size_t i = 0; i < this->decoded.size(); i++)
+			delete this->decoded[i].cooked;
+		for (int i = 0; i < StagingCount; i++)
+		{
+			if (this->staging[i].fence != 0)
+				glDeleteSync(this->staging[i].fence);
+			if (this->staging[i].pbo == 0)
+				continue;
+			if (this->staging[i].mapped != nullptr)
+			{
+				GLState::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, this->staging[i].pbo);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+			GLState::Current().DeleteBuffer(this->staging[i].pbo);
+		}
+		for (size_t i = 0; i < this->textures.size(); i++)
+			if (this->textures[i].id != 0)
+				GLState::Current().DeleteTexture(this->textures[i].id);
+		GLState::Current().DeleteTexture(this->placeholder);
+	};
+
+	//queues an image for decoding and returns a handle to it. wrapMode is used for both s and t.
+	//borderColor is optional and only matters for GL_CLAMP_TO_BORDER.
+	Handle Load(const std::string& path, GLint wrapMode = GL_REPEAT, const GLfloat* borderColor = nullptr)
+	{
+		TextureEntry entry = {};
+		entry.path = path;
+		entry.wrapMode = wrapMode;
+		entry.hasBorderColor = borderColor != nullptr;
+		if (borderColor != nullptr)
+			memcpy(entry.borderColor, borderColor, sizeof(entry.borderColor));
+		Handle handle = this->textures.size();
+		this->textures.push_back(entry);
+		this->Queue(handle, false);
+		return handle;
+	};
+	//decodes and uploads the texture again. GetTexture keeps returning the old one until the new one is ready.
+	//returns the id of this load. GetFinishedLoad reaches it once the load has finished
+	GLuint Reload(Handle handle)
+	{
+		return this->Queue(handle, true);
+	};
+	const std::string& GetPath(Handle handle) const
+	{
+		return this->textures[handle].path;
+	};
+	//goes up by one every time a new version of the texture has been uploaded
+	GLuint GetGeneration(Handle handle) const
+	{
+		return this->textures[handle].generation;
+	};
+	//id of the newest load of the texture that has finished, also when it failed. loads that finish after a newer one are dropped
+	GLuint GetFinishedLoad(Handle handle) const
+	{
+		return this->textures[handle].finished;
+	};
+	//true if the last load could not decode the image. the handle keeps returning what it had before (the placeholder or the last good version)
+	bool HasFailed(Handle handle) const
+	{
+		return this->textures[handle].failed;
+	};
+	//the texture to bind for this handle. the placeholder until the real texture has been uploaded
+	GLuint GetTexture(Handle handle) const
+	{
+		return this->textures[handle].id != 0 ? this->textures[handle].id : this->placeholder;
+	};
+	bool IsReady(Handle handle) const
+	{
+		return this->textures[handle].id != 0;
+	};
+	//true once every requested texture has been uploaded or has failed to load, so a broken file does not hold up startup forever
+	bool AllReady() const
+	{
+		for (size_t i = 0; i < this->textures.size(); i++)
+			if (this->textures[i].id == 0 && !this->textures[i].failed)
+				return false;
+		return true;
+	};
+	//memory held by the decode arenas and how often they had to grow. both stop going up once the largest texture has been decoded
+	size_t ArenaBytes()
+	{
+		return this->arenas.Capacity();
+	};
+	unsigned int ArenaGrows()
+	{
+		return this->arenas.Grows();
+	};
+	//must be called on the GL thread, once per frame. uploads at most maxUploads decoded images so a burst of finished
+	//decodes does not cause one long frame.
+	void Update(unsigned int maxUploads = 1)
+	{
+		for (unsigned int i = 0; i < maxUploads; i++)
+		{
+			DecodedImage image;
+			{
+				std::lock_guard<std::mutex> lock(this->decodedMutex);
+				if (this->decoded.empty())
+					return;
+				image = std::move(this->decoded.front());
+				this->decoded.pop_front();
+			}
+			if (!this->Upload(image))
+			{
+				//no PBO is free yet. the image goes back to the front of the queue and is tried again next frame
+				this->UploadsDeferred++;
+				std::lock_guard<std::mutex> lock(this->decodedMutex);
+				this->decoded.push_front(std::move(image));
+				return;
+			}
+		}
+	};
+
+private:
+	struct TextureEntry
+	{
+		std::string path;
+		GLint wrapMode;
+		bool hasBorderColor;
+		GLfloat borderColor[4];
+		GLuint id;
+		GLuint generation;
+		//id of the last load queued and of the newest one that has finished
+		GLuint requested;
+		GLuint finished;
+		bool failed;
+		std::chrono::high_resolution_clock::time_point requestTime;
+	};
+	struct DecodeRequest
+	{
+		Handle handle;
+		GLuint id;
+		std::string path;
+		//the file was just edited, so it is read instead of mapped
+		bool reload;
+	};
+	struct DecodedImage
+	{
+		Handle handle;
+		//id of the load this image belongs to
+		GLuint request;
+		//the decoded image, in arena
+		unsigned char* pixels;
+		int width, height;
+		double decodeMs;
+		//set when a cooked file was found. the compressed levels are uploaded from it directly
+		CookedTexture* cooked;
+		//the cooked levels decoded to RGBA8 one after the other, only when the driver can't take the compressed format. also in arena
+		unsigned char* fallback;
+		//holds pixels or fallback and goes back to the pool once they are uploaded
+		AssetArena* arena;
+	};
+
+	std::vector<TextureEntry> textures;
+	GLuint placeholder;
+	bool hasTexStorage;
+	bool hasPersistentMapping;
+	bool hasS3TC;
+
+	//worker threads wait on requests and push their results into decoded
+	std::vector<std::thread> workers;
+	std::deque<DecodeRequest> requests;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool quit;
+	std::deque<DecodedImage> decoded;
+	std::mutex decodedMutex;
+	AssetArenaPool arenas;
+
+	//staging buffers the decoded pixels are copied into, used in turn. with persistent mapping each stays mapped for its whole life
+	struct StagingBuffer
+	{
+		GLuint pbo;
+		size_t size;
+		void* mapped;
+		//signalled when the GPU has finished reading the last upload out of the buffer
+		GLsync fence;
+	};
+	//enough for the uploads of a few frames to be in flight at once
+	static const int StagingCount = 4;
+	StagingBuffer staging[StagingCount];
+	int nextStaging;
+
+	GLuint Queue(Handle handle, bool reload)
+	{
+		TextureEntry& entry = this->textures[handle];
+		entry.requestTime = std::chrono::high_resolution_clock::now();
+		GLuint id = ++entry.requested;
+		{
+			std::lock_guard<std::mutex> lock(this->queueMutex);
+			this->requests.push_back(DecodeRequest());
+			this->requests.back().handle = handle;
+			this->requests.back().id = id;
+			this->requests.back().path = entry.path;
+			this->requests.back().reload = reload;
+		}
+		this->queueCondition.notify_one();
+		return id;
+	};
+
+	void WorkerLoop()
+	{
+		Profiler::Instance().SetThreadName("Texture worker");
+		for (;;)
+		{
+			DecodeRequest request;
+			{
+				std::unique_lock<std::mutex> lock(this->queueMutex);
+				while (!this->quit && this->requests.empty())
+					this->queueCondition.wait(lock);
+				if (this->quit)
+					return;
+				request = this->requests.front();
+				this->requests.pop_front();
+			}
+			ProfileZone zone("Texture decode", false, request.path.c_str());
+			DecodedImage image;
+			image.handle = request.handle;
+			image.request = request.id;
+			image.pixels = nullptr;
+			image.fallback = nullptr;
+			image.arena = nullptr;
+			image.cooked = new CookedTexture();
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			//a cooked file older than its image is out of date (the image was edited after cooking), so the image is used instead
+			std::string cookedPath = CookedTexture::CookedPath(request.path);
+			if (FileWatcher::LastWriteTime(cookedPath) >= FileWatcher::LastWriteTime(request.path) && image.cooked->Open(cookedPath, request.reload))
+			{
+				image.width = image.cooked->Width();
+				image.height = image.cooked->Height();
+				if (!this->hasS3TC)
+				{
+					image.arena = this->arenas.Take();
+					image.arena->Reset(image.cooked->DecodedSize());
+					image.fallback = image.arena->Allocate(image.cooked->DecodedSize());
+					unsigned char* level = image.fallback;
+					for (size_t i = 0; i < image.cooked->LevelCount(); i++)
+					{
+						image.cooked->Decode(i, level);
+						level += (size_t)image.cooked->GetLevel(i).width * image.cooked->GetLevel(i).height * 4;
+					}
+				}
+			}
+			else
+			{
+				delete image.cooked;
+				image.cooked = nullptr;
+				//SOIL does not touch OpenGL when it only decodes so it is safe to call from a worker thread.
+				//it reads the compressed image straight from the mapping instead of going through its own file buffer
+				MappedFile file;
+				unsigned char* soilPixels = nullptr;
+				if (file.Open(request.path, request.reload) && file.Size() > 0)
+					soilPixels = SOIL_load_image_from_memory(file.Data(), (int)file.Size(), &image.width, &image.height, 0, SOIL_LOAD_RGB);
+				if (soilPixels == nullptr)
+				{
+					std::cout << "ERROR::TEXTURE::DECODE_FAILED " << request.path << std::endl;
+				}
+				else
+				{
+					//SOIL's buffer is given back right here on the worker. only the arena is held until the upload
+					size_t size = (size_t)image.width * image.height * 3;
+					image.arena = this->arenas.Take();
+					image.arena->Reset(size);
+					image.pixels = image.arena->Allocate(size);
+					memcpy(image.pixels, soilPixels, size);
+					SOIL_free_image_data(soilPixels);
+				}
+			}
+			image.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			std::lock_guard<std::mutex> lock(this->decodedMutex);
+			this->decoded.push_back(std::move(image));
+		}
+	};
+
+	//2x2 grey checkerboard shown while the real texture is still loading
+	void CreatePlaceholder()
+	{
+		const unsigned char pixels[] = {
+			128, 128, 128,	64, 64, 64,
+			64, 64, 64,		128, 128, 128
+		};
+		glGenTextures(1, &this->placeholder);
+		GLState::Current().BindTexture(this->placeholder);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 2, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	};
+
+	//the next staging buffer the GPU is done with, or nullptr if all of them are still being read. never waits:
+	//the fences are only polled, and a buffer that is still in use is left for a later frame
+	StagingBuffer* FindStaging()
+	{
+		for (int i = 0; i < StagingCount; i++)
+		{
+			int index = (this->nextStaging + i) % StagingCount;
+			StagingBuffer& buffer = this->staging[index];
+			if (buffer.fence != 0)
+			{
+				GLenum result = glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+				if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+					continue;
+				glDeleteSync(buffer.fence);
+				buffer.fence = 0;
+			}
+			this->nextStaging = (index + 1) % StagingCount;
+			return &buffer;
+		}
+		return nullptr;
+	};
+
+	//makes sure the staging buffer can hold size bytes, then returns where to write. it has to be free (see FindStaging)
+	void* MapStaging(StagingBuffer& buffer, size_t size)
+	{
+		GLState::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+		if (size > buffer.size)
+		{
+			//immutable storage cannot be resized so the buffer is recreated
+			if (buffer.pbo != 0)
+			{
+				if (buffer.mapped != nullptr)
+					glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				GLState::Current().DeleteBuffer(buffer.pbo);
+			}
+			buffer.mapped = nullptr;
+			buffer.size = size;
+			glGenBuffers(1, &buffer.pbo);
+			GLState::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+			if (this->hasPersistentMapping)
+			{
+				GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+				glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+				buffer.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+			}
+			else
+			{
+				glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			}
+		}
+		if (buffer.mapped != nullptr)
+			return buffer.mapped;
+		//without persistent mapping we map the buffer for every upload and tell the driver the old contents can be thrown away
+		return glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	};
+
+	//creates the texture object and sets its wrapping and filtering
+	GLuint CreateTexture(const TextureEntry& entry)
+	{
+		GLuint texture;
+		glGenTextures(1, &texture);
+		GLState::Current().BindTexture(texture);
+		//texture wrapping and filtering. see the comments in main for what each of these options does
+		if (entry.hasBorderColor)
+			glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, entry.borderColor);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, entry.wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, entry.wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		return texture;
+	};
+
+	//false if the image has pixels to upload but no staging buffer is free. nothing has changed then and it can be tried again
+	bool Upload(DecodedImage& image)
+	{
+		TextureEntry& entry = this->textures[image.handle];
+		//the workers run side by side, so a newer load of the same file can finish first. this one is out of date then
+		if (image.request < entry.finished)
+		{
+			if (image.arena != nullptr)
+				this->arenas.Give(image.arena);
+			delete image.cooked;
+			return true;
+		}
+		StagingBuffer* buffer = nullptr;
+		if (image.cooked != nullptr || image.pixels != nullptr)
+		{
+			buffer = this->FindStaging();
+			if (buffer == nullptr)
+				return false;
+		}
+		entry.finished = image.request;
+		if (image.cooked != nullptr)
+		{
+			this->UploadCooked(image, *buffer);
+			return true;
+		}
+		if (image.pixels == nullptr)
+		{
+			//the worker already said why. whatever the handle showed before stays, and the load counts as finished
+			entry.failed = true;
+			std::cout << "Texture " << entry.path << ": failed to load, keeping " << (entry.id != 0 ? "the previous version" : "the placeholder") << std::endl;
+			return true;
+		}
+		ProfileZone zone("Texture upload", true, entry.path.c_str());
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		size_t size = (size_t)image.width * image.height * 3;
+		void* staging = this->MapStaging(*buffer, size);
+		memcpy(staging, image.pixels, size);
+		this->arenas.Give(image.arena);
+		image.arena = nullptr;
+		image.pixels = nullptr;
+		if (buffer->mapped == nullptr)
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		GLuint texture = this->CreateTexture(entry);
+		//the rows of an RGB image are not always a multiple of 4 bytes long
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (this->hasTexStorage)
+		{
+			//immutable storage allocates every mipmap level up front. the driver never has to check whether the texture is complete again
+			GLsizei levels = 1;
+			for (int size = image.width > image.height ? image.width : image.height; size > 1; size >>= 1)
+				levels++;
+			glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGB8, image.width, image.height);
+			//with a PBO bound, the last argument is an offset into the PBO instead of a pointer to client memory
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)0);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)0);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		//a bound unpack buffer would turn the pointer of every later glTexImage2D into an offset, so this one has to be unbound
+		GLState::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		this->Replace(entry, texture);
+
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		double uploadMs = std::chrono::duration<double, std::milli>(end - start).count();
+		double totalMs = std::chrono::duration<double, std::milli>(end - entry.requestTime).count();
+		//drivers store RGB8 with 4 bytes per texel and the full mipmap chain adds another third
+		size_t memory = (size_t)image.width * image.height * 4 * 4 / 3;
+		std::cout << "Texture " << entry.path << " (" << image.width << "x" << image.height << ", RGB8): decode " << image.decodeMs
+			<< " ms, upload " << uploadMs << " ms, ready after " << totalMs << " ms, ~" << (memory / 1024) << " KB texture memory" << std::endl;
+		return true;
+	};
+
+	//makes texture the one the handle returns. a texture that is being reloaded is deleted only now, so there is always one to draw with
+	void Replace(TextureEntry& entry, GLuint texture)
+	{
+		if (entry.id != 0)
+			GLState::Current().DeleteTexture(entry.id);
+		entry.id = texture;
+		entry.generation++;
+		entry.failed = false;
+	};
+
+	//uploads every level of a cooked texture through a staging buffer, like a decoded image. there is nothing to decode or mipmap:
+	//the levels are copied into the PBO one after the other (compressed from the mapped file, or the RGBA8 fallback) and each one is
+	//uploaded from its offset
+	void UploadCooked(DecodedImage& image, StagingBuffer& buffer)
+	{
+		TextureEntry& entry = this->textures[image.handle];
+		CookedTexture* cooked = image.cooked;
+		ProfileZone zone("Texture upload", true, entry.path.c_str());
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		bool compressed = image.fallback == nullptr;
+		size_t memory = compressed ? cooked->CompressedSize() : cooked->DecodedSize();
+		unsigned char* staging = (unsigned char*)this->MapStaging(buffer, memory);
+		if (compressed)
+		{
+			size_t offset = 0;
+			for (size_t i = 0; i < cooked->LevelCount(); i++)
+			{
+				memcpy(staging + offset, cooked->GetLevel(i).data, cooked->GetLevel(i).size);
+				offset += cooked->GetLevel(i).size;
+			}
+		}
+		else
+		{
+			//the fallback levels already lie one after the other in the arena
+			memcpy(staging, image.fallback, memory);
+			this->arenas.Give(image.arena);
+			image.arena = nullptr;
+		}
+		if (buffer.mapped == nullptr)
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		GLuint texture = this->CreateTexture(entry);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)cooked->LevelCount() - 1);
+		GLenum internalFormat = compressed ? cooked->GLFormat() : GL_RGBA8;
+		//immutable storage for every level, as for decoded images
+		if (this->hasTexStorage)
+			glTexStorage2D(GL_TEXTURE_2D, (GLsizei)cooked->LevelCount(), internalFormat, cooked->Width(), cooked->Height());
+		size_t offset = 0;
+		for (size_t i = 0; i < cooked->LevelCount(); i++)
+		{
+			const CookedTexture::Level& level = cooked->GetLevel(i);
+			size_t levelSize = compressed ? level.size : (size_t)level.width * level.height * 4;
+			//with a PBO bound, the last argument is an offset into the PBO instead of a pointer to client memory
+			if (compressed && this->hasTexStorage)
+				glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height, internalFormat, (GLsizei)levelSize, (GLvoid*)offset);
+			else if (compressed)
+				glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, level.width, level.height, 0, (GLsizei)levelSize, (GLvoid*)offset);
+			else if (this->hasTexStorage)
+				glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)offset);
+			else
+				glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)offset);
+			offset += levelSize;
+		}
+		buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		//a bound unpack buffer would turn the pointer of every later glTexImage2D into an offset, so this one has to be unbound
+		GLState::Current().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		this->Replace(entry, texture);
+		const char* format = image.fallback != nullptr ? "RGBA8 fallback" : cooked->GetFormat() == CookedTexture::BC1 ? "BC1" : "BC3";
+		//the levels are in the PBO now, so the file can be unmapped
+		delete cooked;
+		image.cooked = nullptr;
+
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		double uploadMs = std::chrono::duration<double, std::milli>(end - start).count();
+		double totalMs = std::chrono::duration<double, std::milli>(end - entry.requestTime).count();
+		std::cout << "Texture " << entry.path << " (" << image.width << "x" << image.height << ", cooked " << format << "): load " << image.decodeMs
+			<< " ms, upload " << uploadMs << " ms, ready after " << totalMs << " ms, " << (memory / 1024) << " KB texture memory" << std::endl;
+	};
+};
+
+#endif // TEXTURE_LOADER_H
@@ -0,0 +1,22 @@
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 texCoord;
+//model-view-projection matrix of every object in this draw call, written by ObjectScene.h. gl_InstanceID picks ours.
+//256 matrices is 16KB, the largest uniform block every GL 3.3 driver has to support
+layout(std140) uniform ObjectMatrices
+{
+	mat4 objectMatrix[256];
+};
+
+out vec3 ourColor;
+out vec2 TexCoord;
+out vec4 Tint;
+
+void main()
+{
+gl_Position = objectMatrix[gl_InstanceID] * vec4(position, 1.0);
+ourColor = color;
+TexCoord = texCoord;
+Tint = vec4(1.0);
+}
@@ -1,6 +1,7 @@
 #version 330 core
 in vec3 ourColor;
 in vec2 TexCoord;
+in vec4 Tint;
 out vec4 color;
 
 uniform sampler2D ourTexture1;
@@ -8,5 +9,5 @@ uniform sampler2D ourTexture2;
 
 void main()
 { 
-color = mix(texture(ourTexture1, TexCoord),texture(ourTexture2, TexCoord), 0.2);
+color = mix(texture(ourTexture1, TexCoord),texture(ourTexture2, TexCoord), 0.2) * Tint;
 }
\ No newline at end of file
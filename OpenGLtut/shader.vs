@@ -2,13 +2,23 @@
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec2 texCoord;
+//per-instance attributes. these advance once per quad instead of once per vertex (see QuadBatch.h)
+//2D transform of the quad as 2 rows of a 2x3 matrix
+layout(location = 3) in vec3 instanceRow0;
+layout(location = 4) in vec3 instanceRow1;
+//part of the texture to show: offset in xy, size in zw
+layout(location = 5) in vec4 instanceTexRect;
+layout(location = 6) in vec4 instanceTint;
 
 out vec3 ourColor;
 out vec2 TexCoord;
+out vec4 Tint;
 
 void main()
 { 
-gl_Position = vec4(position, 1.0);
+vec2 transformed = vec2(dot(instanceRow0.xy, position.xy) + instanceRow0.z, dot(instanceRow1.xy, position.xy) + instanceRow1.z);
+gl_Position = vec4(transformed, position.z, 1.0);
 ourColor = color;
-TexCoord = texCoord;
+TexCoord = instanceTexRect.xy + texCoord * instanceTexRect.zw;
+Tint = instanceTint;
 }		
\ No newline at end of file